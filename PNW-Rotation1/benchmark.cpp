@@ -0,0 +1,543 @@
+// PNWRotationBench - reproducible micro-benchmarks of the PNW-Rotation1 hot paths
+//
+// PNWRotationBench [--json <file>] [--filter <text>] [--max-stations <n>] [--quick]
+//
+// Inputs are synthetic and generated from fixed seeds, each case reports the
+// median and minimum of repeated runs. Progress goes to stderr, the JSON
+// report to stdout or the --json file.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gpsData.h"
+#include "gpsDataCache.h"
+#include "gpsTransform.h"
+#include "transform12.h"
+#include "transformKernel.h"
+
+#ifdef PNW_BENCH_GAUSS_NEWTON
+#include "gaussNewton2D.h"
+#include "gaussNewtonPyramid.h"
+#include "gradientCpu.h"
+#include "registrationSession.h"
+#include "displacementFn.h"
+#include "gradientFn.h"
+#endif
+
+#ifdef PNW_BENCH_TRACKS
+#include "trackEnsemble.h"
+#endif
+
+namespace
+{
+  struct BenchOptions
+  {
+    std::string jsonFile;
+    std::string filter;
+    long long maxStations = 10000000;
+    double minSeconds = 0.25; // per case
+    int minRepetitions = 3;
+    int maxRepetitions = 50;
+  };
+
+  struct BenchResult
+  {
+    std::string name;
+    std::string variant;
+    long long size;
+    int repetitions;
+    double medianMs;
+    double minMs;
+    double itemsPerSecond; // size / median
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  // Runs fn once to warm up, then repeatedly until minSeconds and minRepetitions are met
+  template <typename Fn>
+  void measure(const std::string &name, const std::string &variant, long long size,
+               const BenchOptions &options, std::vector<BenchResult> &results, Fn &&fn)
+  {
+    const std::string label = name + "/" + variant;
+    if (!options.filter.empty() && label.find(options.filter) == std::string::npos)
+      return;
+
+    fn();
+    std::vector<double> times;
+    const Clock::time_point start = Clock::now();
+    do
+    {
+      const Clock::time_point t0 = Clock::now();
+      fn();
+      times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    } while ((int)times.size() < options.maxRepetitions &&
+             ((int)times.size() < options.minRepetitions ||
+              std::chrono::duration<double>(Clock::now() - start).count() < options.minSeconds));
+
+    std::sort(times.begin(), times.end());
+    const double median = times[times.size() / 2];
+    BenchResult r = {name, variant, size, (int)times.size(), median, times.front(), median > 0 ? size / (median / 1000.0) : 0.0};
+    results.push_back(r);
+    std::fprintf(stderr, "%-34s %-14s %10lld %12.4f ms %14.0f items/s\n",
+                 name.c_str(), variant.c_str(), size, median, r.itemsPerSecond);
+  }
+
+  // Silences the "Loaded N points" lines while a case runs
+  struct QuietCout
+  {
+    std::streambuf *saved = std::cout.rdbuf(nullptr);
+    ~QuietCout()
+    {
+      std::cout.rdbuf(saved);
+      std::cout.clear();
+    }
+  };
+
+  // Stations inside gpsBounds following a known transform plus noise
+  std::vector<GPS_VData_Point> syntheticStations(size_t count, uint64_t seed)
+  {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<float> lon(gpsBounds.minLon + 0.01f, gpsBounds.maxLon - 0.01f);
+    std::uniform_real_distribution<float> lat(gpsBounds.minLat + 0.01f, gpsBounds.maxLat - 0.01f);
+    std::uniform_real_distribution<float> sigma(0.2f, 1.5f);
+    std::normal_distribution<float> noise(0.0f, 0.5f);
+
+    const float cx = (gpsBounds.maxLon + gpsBounds.minLon) / 2.0f;
+    const float cy = (gpsBounds.maxLat + gpsBounds.minLat) / 2.0f;
+    std::vector<GPS_VData_Point> stations(count);
+    for (GPS_VData_Point &p : stations)
+    {
+      p.lon = lon(rng);
+      p.lat = lat(rng);
+      const float u = p.lon - cx;
+      const float v = p.lat - cy;
+      p.Ve = 2.0f + 0.4f * u + 0.3f * v + noise(rng);
+      p.Vn = -1.0f + 0.3f * v + 0.4f * u + noise(rng);
+      p.Se = sigma(rng);
+      p.Sn = sigma(rng);
+      p.Ren = 0.0f;
+    }
+    return stations;
+  }
+
+  // Same layout as the NSHM velocity files
+  bool writeStationFile(const std::string &filename, const std::vector<GPS_VData_Point> &stations)
+  {
+    FILE *file = std::fopen(filename.c_str(), "w");
+    if (!file)
+      return false;
+    std::fprintf(file, "//Synthetic GPS velocities for PNWRotationBench\n");
+    for (const GPS_VData_Point &p : stations)
+      std::fprintf(file, "%9.4f %8.4f %8.3f %8.3f %8.3f %8.3f %8.3f\n", p.lon, p.lat, p.Ve, p.Vn, p.Se, p.Sn, p.Ren);
+    return std::fclose(file) == 0;
+  }
+
+  std::vector<long long> stationSizes(long long first, long long last, long long maxStations)
+  {
+    std::vector<long long> sizes;
+    for (long long n = first; n <= last && n <= maxStations; n *= 10)
+      sizes.push_back(n);
+    return sizes;
+  }
+
+  void benchReadDataFile(const BenchOptions &options, std::vector<BenchResult> &results)
+  {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "pnwRotationBench";
+    std::filesystem::create_directories(dir);
+
+    for (long long n : stationSizes(1000, 1000000, options.maxStations))
+    {
+      const std::string filename = (dir / ("stations_" + std::to_string(n) + ".txt")).string();
+      const std::string cacheFile = GpsDataCache::cacheFileName(filename);
+      if (!writeStationFile(filename, syntheticStations(n, 1)))
+      {
+        std::cerr << "Error: Could not write " << filename << std::endl;
+        return;
+      }
+
+      std::vector<GPS_VData_Point> stations;
+      QuietCout quiet;
+      // Text parse plus cache write, as on the first run over a new file
+      measure("readDataFile", "parse", n, options, results, [&]()
+      {
+        std::filesystem::remove(cacheFile);
+        readDataFile(filename, stations);
+      });
+      // Cache mapped and copied out, as on every later run
+      measure("readDataFile", "cached", n, options, results, [&]()
+      {
+        readDataFile(filename, stations);
+      });
+
+      std::filesystem::remove(cacheFile);
+      std::filesystem::remove(filename);
+    }
+  }
+
+  void benchTransform12(const BenchOptions &options, std::vector<BenchResult> &results)
+  {
+    const SimdLevel detected = detectSimdLevel();
+    for (long long n : stationSizes(1000, 10000000, options.maxStations))
+    {
+      std::vector<GPS_VData_Point> stations = syntheticStations(n, 2);
+      GPS_VDataSoA soa(stations);
+      Eigen::Vector4f x;
+      float R2;
+
+      measure("getTransform12", "aos", n, options, results, [&]()
+      { getTransform12(stations, x, &R2); });
+
+      for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2})
+      {
+        if (level > detected)
+          break;
+        measure("getTransform12", std::string("soa/") + simdLevelName(level), n, options, results, [&]()
+        { getTransform12(soa.columns(), x, &R2, level); });
+      }
+
+      // IRLS passes make this the slowest case, keep it to realistic network sizes
+      if (n <= 1000000)
+        measure("getTransform12", "robust", n, options, results, [&]()
+        { getTransform12(soa.columns(), x, &R2, RobustParams()); });
+    }
+  }
+
+#ifdef PNW_BENCH_GAUSS_NEWTON
+  // Smooth random texture from a few seeded sinusoids
+  void syntheticImage(Image<float> &image, int w, int h, uint64_t seed, const float4 &T)
+  {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<float> freq(0.01f, 0.08f);
+    std::uniform_real_distribution<float> phase(0.0f, 6.2831853f);
+    const int WAVES = 12;
+    float fx[WAVES], fy[WAVES], ph[WAVES];
+    for (int k = 0; k < WAVES; k++)
+    {
+      fx[k] = freq(rng);
+      fy[k] = freq(rng);
+      ph[k] = phase(rng);
+    }
+
+    // Sample at the transformed position so frame = ref moved by T (tx, ty, s, theta)
+    const float cx = w / 2.0f, cy = h / 2.0f;
+    float *data = image.HData();
+    for (int j = 0; j < h; j++)
+    {
+      for (int i = 0; i < w; i++)
+      {
+        const float u = i - cx, v = j - cy;
+        const float x = cx + u * (1 + T.z) - v * T.w - T.x;
+        const float y = cy + v * (1 + T.z) + u * T.w - T.y;
+        float value = 0.0f;
+        for (int k = 0; k < WAVES; k++)
+          value += std::sin(fx[k] * x + fy[k] * y + ph[k]);
+        data[j * w + i] = 128.0f + 10.0f * value;
+      }
+    }
+  }
+
+  // 5 point Laplacian, zero on the border
+  void laplacian(Image<float> &out, Image<float> &in, int w, int h)
+  {
+    const float *p = in.HData();
+    float *q = out.HData();
+    for (int j = 0; j < h; j++)
+    {
+      for (int i = 0; i < w; i++)
+      {
+        const int idx = j * w + i;
+        q[idx] = (i == 0 || j == 0 || i == w - 1 || j == h - 1)
+                     ? 0.0f
+                     : p[idx - 1] + p[idx + 1] + p[idx - w] + p[idx + w] - 4 * p[idx];
+      }
+    }
+  }
+
+  // GradientCpu against GradientFn on the CPU, away from the borders: the
+  // least squares scale between them, what is left after scaling, and the
+  // share of pixels GRAD_THRESH selects differently
+  void checkGradientScale(Image<float> &image, Image<float2> &fnGradient, int size)
+  {
+    Image<float2> cpuGradient(size, size);
+    GradientCpu::Convolve(cpuGradient, image);
+    const float2 *fn = fnGradient.HData();
+    const float2 *cpu = cpuGradient.HData();
+
+    double fnCpu = 0.0, cpuCpu = 0.0;
+    for (int j = 2; j < size - 2; j++)
+      for (int i = 2; i < size - 2; i++)
+      {
+        const size_t idx = (size_t)j * size + i;
+        fnCpu += (double)fn[idx].x * cpu[idx].x + (double)fn[idx].y * cpu[idx].y;
+        cpuCpu += (double)cpu[idx].x * cpu[idx].x + (double)cpu[idx].y * cpu[idx].y;
+      }
+    const double scale = cpuCpu > 0.0 ? fnCpu / cpuCpu : 0.0;
+
+    double maxFn = 0.0, maxResidual = 0.0;
+    long long differ = 0, count = 0;
+    for (int j = 2; j < size - 2; j++)
+      for (int i = 2; i < size - 2; i++, count++)
+      {
+        const size_t idx = (size_t)j * size + i;
+        maxFn = std::max(maxFn, (double)std::max(std::abs(fn[idx].x), std::abs(fn[idx].y)));
+        maxResidual = std::max(maxResidual, std::max(std::abs(fn[idx].x - scale * cpu[idx].x), std::abs(fn[idx].y - scale * cpu[idx].y)));
+        const bool fnSelected = std::sqrt(fn[idx].x * fn[idx].x + fn[idx].y * fn[idx].y) > GRAD_THRESH;
+        const bool cpuSelected = std::sqrt(cpu[idx].x * cpu[idx].x + cpu[idx].y * cpu[idx].y) > GRAD_THRESH;
+        differ += fnSelected != cpuSelected;
+      }
+    std::fprintf(stderr, "check GradientCpu vs GradientFn %dx%d: scale %.6g, residual %.3g of %.3g, GRAD_THRESH differs on %.2f%% of pixels\n",
+                 size, size, scale, maxResidual, maxFn, count ? 100.0 * differ / count : 0.0);
+  }
+
+  void benchGaussNewton(const BenchOptions &options, std::vector<BenchResult> &results)
+  {
+    const float4 T{1.5f, -0.75f, 0.002f, 0.003f};
+    const float sigma = 1.0f;
+    for (int size : {256, 512, 1024, 2048})
+    {
+      Image<float> ref(size, size), frame(size, size);
+      syntheticImage(ref, size, size, 3, float4{0.0f, 0.0f, 0.0f, 0.0f});
+      syntheticImage(frame, size, size, 3, T);
+
+      Image<float> refLaplacian(size, size), frameLaplacian(size, size);
+      laplacian(refLaplacian, ref, size, size);
+      laplacian(frameLaplacian, frame, size, size);
+      Image<float2> refGradient(size, size), frameGradient(size, size);
+      GradientFn::Convolve(refGradient, ref, false);
+      GradientFn::Convolve(frameGradient, frame, false);
+      Image<float4> refDisplacement, frameDisplacement;
+      DisplacementFn::getDisplacement(refDisplacement, refLaplacian, refGradient, sigma);
+      DisplacementFn::getDisplacement(frameDisplacement, frameLaplacian, frameGradient, sigma);
+
+      checkGradientScale(ref, refGradient, size);
+
+      const long long pixels = (long long)size * size;
+      measure("GradientFn::Convolve", "cpu", pixels, options, results, [&]()
+      { GradientFn::Convolve(refGradient, ref, false); });
+      measure("GradientCpu::Convolve", "sobel", pixels, options, results, [&]()
+      { GradientCpu::Convolve(refGradient, ref); });
+
+      float R2;
+      measure("GaussNewton2D::getTransformLSD", "cpu", pixels, options, results, [&]()
+      { GaussNewton2D::getTransformLSD(ref, frame, &R2, false); });
+      measure("GaussNewtonPyramid::getTransformLSD", "cpu", pixels, options, results, [&]()
+      { GaussNewtonPyramid::getTransformLSD(ref, frame, &R2); });
+      PyramidParams sobel;
+      sobel.cpuGradient = true;
+      measure("GaussNewtonPyramid::getTransformLSD", "cpu-sobel", pixels, options, results, [&]()
+      { GaussNewtonPyramid::getTransformLSD(ref, frame, &R2, sobel); });
+      measure("GaussNewton2D::getTransform12", "gradient", pixels, options, results, [&]()
+      { GaussNewton2D::getTransform12(refLaplacian, refGradient, frameLaplacian, frameGradient, &R2, sigma); });
+      measure("GaussNewton2D::getTransform12", "displacement", pixels, options, results, [&]()
+      { GaussNewton2D::getTransform12(refDisplacement, frameDisplacement, &R2); });
+
+      // One reference against a batch of frames, the reference side built once
+      const int FRAMES = 8;
+      std::vector<Image<float> *> frames(FRAMES, &frame);
+      RegistrationSession session(ref);
+      measure("RegistrationSession::registerFrames", "x8", pixels * FRAMES, options, results, [&]()
+      { session.registerFrames(frames); });
+    }
+  }
+#endif
+
+#ifdef PNW_BENCH_TRACKS
+  // Stations with a smooth velocity field around the start of the tracks
+  RotFieldSnapshot syntheticField(int stations, uint64_t seed)
+  {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    RotFieldSnapshot field;
+    std::vector<double> lon, lat;
+    for (int n = 0; n < stations; n++)
+    {
+      lon.push_back(-124.0 + 6.0 * unit(rng));
+      lat.push_back(42.0 + 6.0 * unit(rng));
+      field.ve.push_back(-5.0 + 3.0 * (lat.back() - 45.0));
+      field.vn.push_back(4.0 + 2.0 * (lon.back() + 121.0));
+      field.se.push_back(0.5);
+      field.sn.push_back(0.5);
+    }
+    field.index.build(lon, lat);
+    field.grid.build(field.index, field.ve, field.vn, field.gridParams);
+    return field;
+  }
+
+  // Largest latitude difference between an unperturbed one member ensemble
+  // and the same track stepped directly with TrackStepper, infinity if one
+  // of them reaches a sample longitude the other does not
+  double ensembleTrackDeviation(const RotFieldSnapshot &field, EnsembleParams params)
+  {
+    const double INF = std::numeric_limits<double>::infinity();
+    params.members = 1;
+    params.threads = 1;
+    params.speedSigma = 0;
+    params.bearingSigma = 0;
+    params.stationSigmaScale = 0;
+    params.percentiles = {50};
+    EnsembleResult result;
+    if (!runTrackEnsemble(field, params, result))
+      return INF;
+
+    const double bearing = params.bearing / TrackKinematics::DEG_PER_RAD;
+    TrackState p = {params.startLon, params.startLat, std::sin(bearing) * params.speed, std::cos(bearing) * params.speed};
+    TrackStepper stepper(field, params.method, params.deltaT, params.toleranceKm);
+    double h = params.deltaT;
+    double hNext;
+    const int S = (int)result.sampleLon.size();
+    int sample = 0;
+    double deviation = 0;
+    for (int step = 0; step < params.maxSteps && p.lon > params.longitudeLimit; step++)
+    {
+      const TrackState q = stepper.step(p, h, hNext);
+      h = hNext;
+      while (sample < S && q.lon <= result.sampleLon[sample])
+      {
+        const double t = (p.lon - result.sampleLon[sample]) / (p.lon - q.lon);
+        const double member = result.envelopeLat[0][sample++];
+        deviation = std::isnan(member) ? INF : std::max(deviation, std::abs(member - (p.lat + t * (q.lat - p.lat))));
+      }
+      p = q;
+    }
+    for (; sample < S; sample++)
+      if (result.sampleCount[sample] > 0)
+        deviation = INF;
+    return deviation;
+  }
+
+  // Largest difference between two envelopes over the same samples
+  double envelopeDifference(const EnsembleResult &a, const EnsembleResult &b)
+  {
+    double difference = 0;
+    for (size_t k = 0; k < a.envelopeLat.size(); k++)
+      for (size_t s = 0; s < a.envelopeLat[k].size(); s++)
+      {
+        const double la = a.envelopeLat[k][s], lb = b.envelopeLat[k][s];
+        if (std::isnan(la) != std::isnan(lb))
+          return std::numeric_limits<double>::infinity();
+        if (!std::isnan(la))
+          difference = std::max(difference, std::abs(la - lb));
+      }
+    return difference;
+  }
+
+  void benchTracks(const BenchOptions &options, std::vector<BenchResult> &results)
+  {
+    const RotFieldSnapshot field = syntheticField(400, 5);
+    RotFieldSnapshot stationField = field;
+    stationField.grid.clear();
+
+    EnsembleParams params;
+    params.startLon = -118.5;
+    params.startLat = 44.0;
+    params.speed = 20.0;
+    params.bearing = -80.0;
+    params.speedSigma = 1.0;
+    params.bearingSigma = 3.0;
+    params.longitudeLimit = -123.5;
+
+    // Unperturbed members must follow the single track on the snapshot's own grid or stations
+    std::fprintf(stderr, "check runTrackEnsemble unperturbed vs TrackStepper: grid %.3g deg, stations %.3g deg\n",
+                 ensembleTrackDeviation(field, params), ensembleTrackDeviation(stationField, params));
+
+    // Perturbed members whose grid can't be laid out must step on their own stations,
+    // not on the snapshot's unperturbed grid
+    params.members = 200;
+    RotFieldSnapshot noLayout = field;
+    noLayout.gridParams.step = 1e-4; // past the node limit
+    EnsembleResult withGrid, withStations;
+    runTrackEnsemble(noLayout, params, withGrid);
+    runTrackEnsemble(stationField, params, withStations);
+    std::fprintf(stderr, "check runTrackEnsemble perturbed without a member grid vs stations: %.3g deg\n",
+                 envelopeDifference(withGrid, withStations));
+
+    EnsembleResult result;
+    for (const double scale : {0.0, 1.0})
+    {
+      params.stationSigmaScale = scale;
+      measure("runTrackEnsemble", scale > 0 ? "rk45-stations" : "rk45", params.members, options, results, [&]()
+      { runTrackEnsemble(field, params, result); });
+    }
+  }
+#endif
+
+  void writeJson(std::ostream &out, const std::vector<BenchResult> &results)
+  {
+    out << "{\n";
+    out << "  \"suite\": \"PNWRotationBench\",\n";
+#ifdef NDEBUG
+    out << "  \"build\": \"Release\",\n";
+#else
+    out << "  \"build\": \"Debug\",\n";
+#endif
+    out << "  \"simd\": \"" << simdLevelName(detectSimdLevel()) << "\",\n";
+    out << "  \"threads\": " << std::max(1u, std::thread::hardware_concurrency()) << ",\n";
+    out << "  \"results\": [";
+    for (size_t n = 0; n < results.size(); n++)
+    {
+      const BenchResult &r = results[n];
+      out << (n ? ",\n" : "\n");
+      out << "    {\"name\": \"" << r.name << "\", \"variant\": \"" << r.variant << "\", \"size\": " << r.size
+          << ", \"repetitions\": " << r.repetitions << ", \"median_ms\": " << r.medianMs
+          << ", \"min_ms\": " << r.minMs << ", \"items_per_second\": " << r.itemsPerSecond << "}";
+    }
+    out << "\n  ]\n}\n";
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  BenchOptions options;
+  for (int a = 1; a < argc; a++)
+  {
+    const std::string arg = argv[a];
+    if (arg == "--json" && a + 1 < argc)
+      options.jsonFile = argv[++a];
+    else if (arg == "--filter" && a + 1 < argc)
+      options.filter = argv[++a];
+    else if (arg == "--max-stations" && a + 1 < argc)
+      options.maxStations = std::stoll(argv[++a]);
+    else if (arg == "--quick")
+    {
+      options.maxStations = std::min(options.maxStations, 100000LL);
+      options.minSeconds = 0.05;
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--json <file>] [--filter <text>] [--max-stations <n>] [--quick]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<BenchResult> results;
+  benchReadDataFile(options, results);
+  benchTransform12(options, results);
+#ifdef PNW_BENCH_GAUSS_NEWTON
+  benchGaussNewton(options, results);
+#endif
+#ifdef PNW_BENCH_TRACKS
+  benchTracks(options, results);
+#endif
+
+  if (options.jsonFile.empty())
+    writeJson(std::cout, results);
+  else
+  {
+    std::ofstream file(options.jsonFile);
+    writeJson(file, results);
+    if (!file)
+    {
+      std::cerr << "Error: Could not write " << options.jsonFile << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+#ifndef _PNW_ROTATION_DISPARITY_REDUCTION_H_
+#define _PNW_ROTATION_DISPARITY_REDUCTION_H_
+
+#include "gaussNewton2D.h"
+#include "disparityFn.h"
+#include "displacementFn.h"
+#include "normalEquations.h"
+
+// Fold one accepted disparity sample into the normal equations
+inline void addDisparity(NormalEquations4 &ne, const float4 &D, const float4 &W, const float2 &P, const float2 &c)
+{
+  const float u = P.x - c.x;
+  const float v = P.y - c.y;
+
+  const float uHat = D.x;
+  const float vHat = D.y;
+  const float dMag = D.z;
+
+  float ru = uHat * dMag; // Dx
+  float rv = vHat * dMag; // Dy
+
+  // Jacobian row for Dx: dru/dtx, dru/dty, dru/ds, dru/dtheta
+  ne.add(-1.0f, 0.0f, u, v, ru, W.x);
+  // Jacobian row for Dy: drv/dtx, drv/dty, drv/ds, drv/dtheta
+  ne.add(0.0f, -1.0f, v, -u, rv, W.y);
+}
+
+// One side of a disparity reduction: a precomputed displacement image, or
+// the laplacian / gradient its displacement is evaluated from per pixel
+struct DisplacementSource
+{
+  const float4 *displacement = nullptr;
+  const float *laplacian = nullptr;
+  const float2 *gradient = nullptr;
+
+  static DisplacementSource image(const float4 *displacement)
+  {
+    return {displacement, nullptr, nullptr};
+  }
+
+  static DisplacementSource fields(const float *laplacian, const float2 *gradient)
+  {
+    return {nullptr, laplacian, gradient};
+  }
+
+  inline float4 at(size_t idx, float sigma) const
+  {
+    return displacement ? displacement[idx]
+                        : DisplacementFn::getDisplacement(laplacian[idx], gradient[idx].x, gradient[idx].y, sigma);
+  }
+};
+
+// Single pass over both sides: disparity coefficients are evaluated per
+// row tile and reduced straight into the tile's normal equations, so a
+// laplacian / gradient side never materializes its float4 image.
+// sigma is used only by laplacian / gradient sides.
+inline NormalEquations4 reduceDisparity(const DisplacementSource &ref, const DisplacementSource &frame,
+                                        int w, int h, float sigma, int threads = 0)
+{
+  const float2 c{w / 2.0f, h / 2.0f};
+  return reduceRows(h, [&](NormalEquations4 &ne, int j)
+  {
+    size_t idx = (size_t)j * w;
+    for (int i = 0; i < w; i++, idx++)
+    {
+      float4 D; // ux, uy, D
+      float4 W; // wu wv
+      float2 P; // pu pv
+      if (DisparityFn::getDisparityCoeffs(ref.at(idx, sigma), frame.at(idx, sigma), i, j, D, W, P))
+        addDisparity(ne, D, W, P, c);
+    }
+  }, threads);
+}
+
+// (tx, ty, s, theta) from reduced disparity samples, zero with fewer than 4 samples
+inline float4 solveDisparityTransform(const NormalEquations4 &ne, float *R2)
+{
+  float4 X { 0.0f, 0.0f, 0.0f, 0.0f };
+  if (ne.rows < 8) // need at least 4 samples to regress
+    return X;
+
+  // Residual rms
+  if (R2)
+    *R2 = ne.residual();
+
+  Eigen::Vector4f xVector = ne.solve();
+  X = {xVector(0),
+       xVector(1),
+       xVector(2),
+       xVector(3)};
+  return X;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include "eulerPole.h"
+#include "parallelFor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  const double EARTH_RADIUS_KM = 6371.0;
+  const double DEG = 0.017453292519943295;
+}
+
+EulerPoleSolver::EulerPoleSolver(const GPS_VDataColumns &data)
+{
+  m_unit.resize(data.count);
+  m_terms.resize(data.count);
+  for (size_t s = 0; s < data.count; s++)
+  {
+    const double phi = data.lat[s] * DEG;
+    const double lam = data.lon[s] * DEG;
+    const double sp = sin(phi), cp = cos(phi);
+    const double sl = sin(lam), cl = cos(lam);
+    m_unit[s] = Eigen::Vector3d(cp * cl, cp * sl, sp);
+
+    // Design rows: Ve = R n . omega, Vn = -R e . omega
+    const double ae[3] = {-EARTH_RADIUS_KM * sp * cl, -EARTH_RADIUS_KM * sp * sl, EARTH_RADIUS_KM * cp};
+    const double an[3] = {EARTH_RADIUS_KM * sl, -EARTH_RADIUS_KM * cl, 0.0};
+    const double we = 1.0 / ((double)data.Se[s] * data.Se[s]);
+    const double wn = 1.0 / ((double)data.Sn[s] * data.Sn[s]);
+    const double ve = data.Ve[s];
+    const double vn = data.Vn[s];
+
+    double *t = m_terms[s].v;
+    for (int r = 0; r < 3; r++)
+      for (int c = r; c < 3; c++)
+        *t++ = we * ae[r] * ae[c] + wn * an[r] * an[c];
+    for (int r = 0; r < 3; r++)
+      *t++ = we * ae[r] * ve + wn * an[r] * vn;
+    *t = we * ve * ve + wn * vn * vn;
+  }
+}
+
+EulerPoleFit EulerPoleSolver::solveAll() const
+{
+  Terms sum = {};
+  for (const Terms &terms : m_terms)
+    for (int i = 0; i < 10; i++)
+      sum.v[i] += terms.v[i];
+  return solve(sum, (int)m_terms.size());
+}
+
+EulerPoleFit EulerPoleSolver::solve(const std::vector<int> &ids) const
+{
+  Terms sum = {};
+  for (int id : ids)
+  {
+    const double *t = m_terms[id].v;
+    for (int i = 0; i < 10; i++)
+      sum.v[i] += t[i];
+  }
+  return solve(sum, (int)ids.size());
+}
+
+void EulerPoleSolver::solveBatch(const std::vector<std::vector<int>> &subsets, std::vector<EulerPoleFit> &poles, int threads) const
+{
+  poles.resize(subsets.size());
+  parallelFor((int)subsets.size(), [&](int k)
+  {
+    poles[k] = solve(subsets[k]);
+  }, threads);
+}
+
+EulerPoleFit EulerPoleSolver::solve(const Terms &sum, int stations)
+{
+  EulerPoleFit fit;
+  fit.stations = stations;
+  if (stations < 2) // 3 unknowns need at least 2 stations (4 rows)
+    return fit;
+
+  const double *v = sum.v;
+  Eigen::Matrix3d N;
+  N << v[0], v[1], v[2],
+       v[1], v[3], v[4],
+       v[2], v[4], v[5];
+  const Eigen::Vector3d b(v[6], v[7], v[8]);
+
+  bool invertible = false;
+  Eigen::Matrix3d Ninv;
+  N.computeInverseWithCheck(Ninv, invertible, 1e-12 * N.norm());
+  if (!invertible)
+    return fit;
+
+  const Eigen::Vector3d omega = Ninv * b;
+  fit.omega = omega;
+  fit.covariance = Ninv;
+  fit.chi2 = std::max(0.0, v[9] - omega.dot(b));
+
+  // Pole position and rate, with first order error propagation
+  const double w2 = omega.squaredNorm();
+  const double w = sqrt(w2);
+  const double rho2 = omega.x() * omega.x() + omega.y() * omega.y();
+  const double rho = sqrt(rho2);
+  if (w <= 0.0)
+    return fit;
+
+  fit.lat = asin(omega.z() / w) / DEG;
+  fit.lon = atan2(omega.y(), omega.x()) / DEG;
+  fit.rate = w / DEG;
+
+  const Eigen::Vector3d dRate = omega / w;
+  Eigen::Vector3d dLat = Eigen::Vector3d::Zero();
+  Eigen::Vector3d dLon = Eigen::Vector3d::Zero();
+  if (rho > 0) // undefined at the geographic poles
+  {
+    dLat = Eigen::Vector3d(-omega.x() * omega.z(), -omega.y() * omega.z(), rho2) / (w2 * rho);
+    dLon = Eigen::Vector3d(-omega.y(), omega.x(), 0.0) / rho2;
+  }
+  fit.sigmaRate = sqrt(dRate.dot(Ninv * dRate)) / DEG;
+  fit.sigmaLat = sqrt(dLat.dot(Ninv * dLat)) / DEG;
+  fit.sigmaLon = sqrt(dLon.dot(Ninv * dLon)) / DEG;
+  fit.valid = true;
+  return fit;
+}
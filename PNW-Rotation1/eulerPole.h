@@ -0,0 +1,62 @@
+#ifndef _PNW_ROTATION_EULER_POLE_H_
+#define _PNW_ROTATION_EULER_POLE_H_
+
+#include "gpsData.h"
+#include "../../eigen-3.4.0/Eigen/Dense"
+#include <vector>
+
+// Weighted Euler pole fit (spherical omega = (wx, wy, wz) least squares).
+// Station velocities are rigid rotation about a pole:
+//   Ve = R n . omega,  Vn = -R e . omega
+// with e, n the local east/north unit vectors and R the Earth radius (km),
+// which makes omega rad/Myr for velocities in mm/yr. Weights are 1/Se^2, 1/Sn^2.
+struct EulerPoleFit
+{
+  bool valid = false;
+  int stations = 0;
+  double lat = 0;          // pole latitude, deg
+  double lon = 0;          // pole longitude, deg
+  double rate = 0;         // deg/Myr, positive counter-clockwise
+  Eigen::Vector3d omega = Eigen::Vector3d::Zero();      // rad/Myr
+  Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero(); // omega covariance, (rad/Myr)^2
+  double sigmaLat = 0;     // 1 sigma, deg
+  double sigmaLon = 0;     // 1 sigma, deg
+  double sigmaRate = 0;    // 1 sigma, deg/Myr
+  double chi2 = 0;         // weighted misfit
+};
+
+// Batch Euler pole regression over subsets of one station set.
+// Every station's unit ECEF vector and its share of the 3x3 normal
+// equations are cached once, so a subset solve is a sum of 10 doubles per
+// station plus a closed form 3x3 inverse.
+class EulerPoleSolver
+{
+public:
+  explicit EulerPoleSolver(const GPS_VDataColumns &data);
+
+  size_t size() const { return m_terms.size(); }
+  const Eigen::Vector3d &unitVector(int station) const { return m_unit[station]; }
+
+  // Fit every station
+  EulerPoleFit solveAll() const;
+
+  // Fit one subset of station indices, an empty subset is an invalid fit
+  EulerPoleFit solve(const std::vector<int> &ids) const;
+
+  // Fit many subsets in parallel, poles[k] belongs to subsets[k]
+  void solveBatch(const std::vector<std::vector<int>> &subsets, std::vector<EulerPoleFit> &poles, int threads = 0) const;
+
+private:
+  // A'WA upper triangle (xx xy xz yy yz zz), A'Wv (x y z), v'Wv
+  struct Terms
+  {
+    double v[10];
+  };
+
+  std::vector<Eigen::Vector3d> m_unit;
+  std::vector<Terms> m_terms;
+
+  static EulerPoleFit solve(const Terms &sum, int stations);
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "gaussNewtonPyramid.h"
+#include <algorithm>
+#include <cmath>
+#include "gradientCpu.h"
+#include "gradientFn.h"
+#include "imagePool.h"
+#include "normalEquations.h"
+#include "parallelFor.h"
+
+#define sqr(x) ((x)*(x))
+
+namespace
+{
+  // 2x2 box average, odd last rows / columns are dropped
+  void downsample(Image<float> &out, Image<float> &in, int threads)
+  {
+    const int w = in.Width();
+    const int ow = out.Width();
+    const float *src = in.HData();
+    float *dst = out.HData();
+    parallelFor(out.Height(), [&](int j)
+    {
+      const float *r0 = src + (size_t)(2 * j) * w;
+      const float *r1 = r0 + w;
+      float *o = dst + (size_t)j * ow;
+      for (int i = 0; i < ow; i++)
+        o[i] = 0.25f * (r0[2 * i] + r0[2 * i + 1] + r1[2 * i] + r1[2 * i + 1]);
+    }, threads);
+  }
+
+  // Bilinear sample of the frame and its gradient, false outside the image
+  inline bool sampleFrame(const float *image, const float2 *gradient, int w, int h, float x, float y, float &value, float2 &g)
+  {
+    if (!(x >= 0.0f && y >= 0.0f && x < w - 1 && y < h - 1))
+      return false;
+    const int i = (int)x;
+    const int j = (int)y;
+    const float fx = x - i;
+    const float fy = y - j;
+    const float w00 = (1 - fx) * (1 - fy), w10 = fx * (1 - fy), w01 = (1 - fx) * fy, w11 = fx * fy;
+    const size_t idx = (size_t)j * w + i;
+    value = w00 * image[idx] + w10 * image[idx + 1] + w01 * image[idx + w] + w11 * image[idx + w + 1];
+    g.x = w00 * gradient[idx].x + w10 * gradient[idx + 1].x + w01 * gradient[idx + w].x + w11 * gradient[idx + w + 1].x;
+    g.y = w00 * gradient[idx].y + w10 * gradient[idx + 1].y + w01 * gradient[idx + w].y + w11 * gradient[idx + w + 1].y;
+    return true;
+  }
+
+  // Normal equations of one step at one level. The frame is sampled at
+  // p - d(p), d = (tx - s u - theta v, ty - s v + theta u), so that the
+  // unknowns are increments on X in the single step model.
+  NormalEquations4 reduceLevel(Image<float> &refImage, Image<float2> &refGradientImage,
+                               Image<float> &frameImage, Image<float2> &frameGradientImage,
+                               const float2 &c, const float4 &X, int threads)
+  {
+    const float *dRef = refImage.HData();
+    const float2 *dRefGradient = refGradientImage.HData();
+    const float *dFrame = frameImage.HData();
+    const float2 *dFrameGradient = frameGradientImage.HData();
+    const int w = refImage.Width();
+    const int h = refImage.Height();
+
+    return reduceRows(h, [&](NormalEquations4 &ne, int j)
+    {
+      const float v = j - c.y;
+      size_t idx = (size_t)j * w;
+      for (int i = 0; i < w; i++, idx++)
+      {
+        const float2 gRef = dRefGradient[idx];
+        if (sqrt(sqr(gRef.x) + sqr(gRef.y)) <= GRAD_THRESH)
+          continue;
+
+        const float u = i - c.x;
+        const float dx = X.x - X.z * u - X.w * v;
+        const float dy = X.y - X.z * v + X.w * u;
+        float iFrame;
+        float2 gFrame;
+        if (!sampleFrame(dFrame, dFrameGradient, w, h, i - dx, j - dy, iFrame, gFrame))
+          continue;
+
+        const float ivr = sqr(gRef.x) + sqr(gRef.y); // inverse variance est. of ref and frame
+        const float ivf = sqr(gFrame.x) + sqr(gFrame.y);
+        const float wt = (ivf > 0 ? 1.0f / (1.0f / ivr + 1.0f / ivf) : 0.0f);
+        ne.add(-gFrame.x, -gFrame.y, u * gFrame.x + v * gFrame.y, v * gFrame.x - u * gFrame.y, iFrame - dRef[idx], wt);
+      }
+    }, threads);
+  }
+}
+
+void ImagePyramid::build(Image<float> &image, int levelCount, bool useGpu, int threads, bool cpuGradient)
+{
+  images.clear();
+  gradients.clear();
+
+  // Level 0 is the caller's image, not owned. Coarser levels and the
+  // gradients are pooled per thread: downsample and GradientCpu write every
+  // pixel, GradientFn is not known to, so its images are zeroed
+  images.push_back(std::shared_ptr<Image<float>>(&image, [](Image<float> *) {}));
+  for (int level = 1; level < levelCount; level++)
+  {
+    Image<float> &finer = *images.back();
+    images.push_back(ImagePool<float>::local().acquire(finer.Width() / 2, finer.Height() / 2));
+    downsample(*images.back(), finer, threads);
+  }
+
+  const bool gradientCpu = cpuGradient && !useGpu;
+  for (const std::shared_ptr<Image<float>> &level : images)
+  {
+    gradients.push_back(ImagePool<float2>::local().acquire(level->Width(), level->Height(), !gradientCpu));
+    if (gradientCpu)
+      GradientCpu::Convolve(*gradients.back(), *level, GradientKernel::sobel(), threads);
+    else
+      GradientFn::Convolve(*gradients.back(), *level, useGpu);
+  }
+}
+
+int GaussNewtonPyramid::levelCount(int w, int h, const PyramidParams &params)
+{
+  int levels = 1;
+  int side = std::min(w, h);
+  while ((params.levels <= 0 || levels < params.levels) && side / 2 >= std::max(params.minSize, 2))
+  {
+    side /= 2;
+    levels++;
+  }
+  return levels;
+}
+
+float4 GaussNewtonPyramid::getTransformLSD(
+  Image<float> &refImage,
+  Image<float> &frameImage,
+  float *R2,
+  const PyramidParams &params,
+  PyramidResult *result)
+{
+  const int levels = levelCount(refImage.Width(), refImage.Height(), params);
+  ImagePyramid ref, frame;
+  ref.build(refImage, levels, params.useGpu, params.threads, params.cpuGradient);
+  frame.build(frameImage, levels, params.useGpu, params.threads, params.cpuGradient);
+  return getTransformLSD(ref, frame, R2, params, result);
+}
+
+float4 GaussNewtonPyramid::getTransformLSD(
+  const ImagePyramid &ref,
+  const ImagePyramid &frame,
+  float *R2,
+  const PyramidParams &params,
+  PyramidResult *result)
+{
+  const int levels = std::min(ref.levels(), frame.levels());
+  const float w0 = (float)ref.images[0]->Width();
+  const float h0 = (float)ref.images[0]->Height();
+
+  PyramidResult stats;
+  stats.levels = levels;
+  float4 X{0.0f, 0.0f, 0.0f, 0.0f}; // at the current level, translation in its pixels
+  for (int level = levels - 1; level >= 0; level--)
+  {
+    // Pixel p at this level covers full resolution 2^L p + (2^L - 1) / 2
+    const float scale = (float)(1 << level);
+    const float2 c{(w0 / 2.0f - (scale - 1) / 2.0f) / scale, (h0 / 2.0f - (scale - 1) / 2.0f) / scale};
+    const float radius = std::hypot(c.x, c.y);
+    Image<float> &refLevel = *ref.images[level];
+    Image<float2> &refGradientLevel = *ref.gradients[level];
+    Image<float> &frameLevel = *frame.images[level];
+    Image<float2> &frameGradientLevel = *frame.gradients[level];
+
+    bool converged = false;
+    for (int iteration = 0; iteration < params.maxIterations && !converged; iteration++)
+    {
+      NormalEquations4 ne = reduceLevel(refLevel, refGradientLevel, frameLevel, frameGradientLevel, c, X, params.threads);
+      if (ne.rows <= 4) // need at least 4 samples to regress
+        break;
+      stats.iterations++;
+      if (level == 0)
+      {
+        stats.samples = ne.rows;
+        if (R2)
+          *R2 = ne.residual();
+      }
+
+      const Eigen::Vector4f dX = ne.solve();
+      if (!dX.allFinite())
+        break;
+      X.x += dX(0);
+      X.y += dX(1);
+      X.z += dX(2);
+      X.w += dX(3);
+
+      // Largest pixel motion of the step, at the image corners
+      const float motion = std::hypot(dX(0), dX(1)) + (std::fabs(dX(2)) + std::fabs(dX(3))) * radius;
+      converged = motion < params.tolerance;
+    }
+    if (level == 0)
+      stats.converged = converged;
+    else
+    {
+      X.x *= 2.0f;
+      X.y *= 2.0f;
+    }
+  }
+
+  if (result)
+    *result = stats;
+  return X;
+}
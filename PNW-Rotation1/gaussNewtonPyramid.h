@@ -0,0 +1,65 @@
+#ifndef _PNW_ROTATION_GAUSS_NEWTON_PYRAMID_H_
+#define _PNW_ROTATION_GAUSS_NEWTON_PYRAMID_H_
+
+#include <memory>
+#include <vector>
+#include "gaussNewton2D.h"
+
+struct PyramidParams
+{
+  int levels = 0;           // 0 - halve until the short side drops below minSize
+  int minSize = 32;         // px, smallest short side of the coarsest level
+  int maxIterations = 20;   // Gauss-Newton iterations per level
+  float tolerance = 0.01f;  // px, largest motion of a step anywhere in the image that counts as converged
+  bool useGpu = false;      // GradientFn path
+  bool cpuGradient = false; // GradientCpu instead of GradientFn on the CPU, a different gradient scale so GRAD_THRESH selects other pixels
+  int threads = 0;          // per registration, 0 - all cores
+};
+
+struct PyramidResult
+{
+  int levels = 0;
+  int iterations = 0;     // summed over all levels
+  bool converged = false; // the full resolution level met the tolerance
+  long long samples = 0;  // gradient samples in the last full resolution step
+};
+
+// 2x2 box filtered image pyramid with the gradient of every level.
+// Level 0 refers to the caller's image, which must outlive the pyramid.
+struct ImagePyramid
+{
+  std::vector<std::shared_ptr<Image<float>>> images;
+  std::vector<std::shared_ptr<Image<float2>>> gradients;
+
+  void build(Image<float> &image, int levels, bool useGpu, int threads = 0, bool cpuGradient = false);
+  int levels() const { return (int)images.size(); }
+};
+
+// Coarse to fine version of GaussNewton2D::getTransformLSD.
+// At each level the frame and its gradients are resampled through the
+// current estimate and Gauss-Newton steps are taken until they move no
+// pixel by more than the tolerance, so large motions are found on the
+// small levels and the full resolution level only refines them.
+// Returns the same (tx, ty, s, theta) about the image center as the single step version.
+class GaussNewtonPyramid
+{
+public:
+  static float4 getTransformLSD(
+      Image<float> &refImage,
+      Image<float> &frameImage,
+      float *R2,
+      const PyramidParams &params = PyramidParams(),
+      PyramidResult *result = nullptr);
+
+  // Pyramids built with levelCount(), e.g. to keep the reference pyramid between frames
+  static float4 getTransformLSD(
+      const ImagePyramid &ref,
+      const ImagePyramid &frame,
+      float *R2,
+      const PyramidParams &params = PyramidParams(),
+      PyramidResult *result = nullptr);
+
+  static int levelCount(int w, int h, const PyramidParams &params);
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "gpsData.h"
+#include "mappedFile.h"
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+  const int GPS_COLUMNS = 7;
+  const int MAX_REPORTED_LINES = 20;
+
+  inline bool isBlank(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  // Parse exactly GPS_COLUMNS floats from [p, end), nothing but blanks around them
+  bool parseGpsLine(const char *p, const char *end, float values[GPS_COLUMNS])
+  {
+    for (int n = 0; n < GPS_COLUMNS; n++)
+    {
+      while (p < end && isBlank(*p))
+        p++;
+      if (p < end && *p == '+') // from_chars does not take a leading '+'
+        p++;
+      std::from_chars_result result = std::from_chars(p, end, values[n]);
+      if (result.ec != std::errc())
+        return false;
+      p = result.ptr;
+      if (p < end && !isBlank(*p))
+        return false;
+    }
+    while (p < end && isBlank(*p))
+      p++;
+    return p == end;
+  }
+}
+
+bool parseGpsDataFile(
+    const std::string &filename,
+    const mapBounds &bounds,
+    std::vector<GPS_VData_Point> &gpsData,
+    GPS_ParseStats *stats)
+{
+  MappedFile file;
+  if (!file.open(filename))
+  {
+    std::cerr << "Path: " << std::filesystem::current_path() << std::endl;
+    std::cerr << "Error: Could not open file " << filename << std::endl;
+    return false;
+  }
+
+  GPS_ParseStats localStats;
+  GPS_ParseStats &s = stats ? *stats : localStats;
+  s = GPS_ParseStats();
+
+  gpsData.resize(0);
+  gpsData.reserve(file.size() / 64); // ~60 bytes per NSHM station line
+
+  const char *p = file.data();
+  const char *end = p + file.size();
+  while (p < end)
+  {
+    const char *eol = std::find(p, end, '\n');
+    s.lines++;
+
+    const char *first = p;
+    while (first < eol && isBlank(*first))
+      first++;
+
+    if (first < eol && *first != '/') // skip blanks and '//' comments
+    {
+      float v[GPS_COLUMNS];
+      if (!parseGpsLine(first, eol, v))
+      {
+        s.malformed++;
+        if ((int)s.malformedLines.size() < MAX_REPORTED_LINES)
+          s.malformedLines.push_back(s.lines);
+      }
+      else if (bounds.contains(v[0], v[1]))
+      {
+        gpsData.push_back({v[0], v[1], v[2], v[3], v[4], v[5], v[6]});
+        s.accepted++;
+      }
+      else
+        s.rejected++;
+    }
+    p = eol + (eol < end ? 1 : 0);
+  }
+
+  if (s.malformed)
+  {
+    std::cerr << "Warning: " << s.malformed << " malformed lines in " << filename << " (line";
+    for (int line : s.malformedLines)
+      std::cerr << " " << line;
+    std::cerr << (s.malformed > (int)s.malformedLines.size() ? " ...)" : ")") << std::endl;
+  }
+  return true;
+}
+
+void GPS_VDataSoA::assign(const std::vector<GPS_VData_Point> &gpsData)
+{
+  const size_t ALIGN = 16; // floats, 64 bytes
+  m_count = gpsData.size();
+  m_stride = (m_count + ALIGN - 1) / ALIGN * ALIGN;
+  m_data.assign(m_stride * GPS_COLUMNS + ALIGN, 0.0f);
+
+  // vector storage is only guaranteed 16 byte aligned, skip ahead to a 64 byte boundary
+  const size_t misalign = ((size_t)m_data.data() / sizeof(float)) % ALIGN;
+  m_offset = misalign ? ALIGN - misalign : 0;
+
+  float *lon = m_data.data() + m_offset;
+  float *lat = lon + m_stride;
+  float *Ve = lat + m_stride;
+  float *Vn = Ve + m_stride;
+  float *Se = Vn + m_stride;
+  float *Sn = Se + m_stride;
+  float *Ren = Sn + m_stride;
+  for (size_t n = 0; n < m_count; n++)
+  {
+    const GPS_VData_Point &p = gpsData[n];
+    lon[n] = p.lon;
+    lat[n] = p.lat;
+    Ve[n] = p.Ve;
+    Vn[n] = p.Vn;
+    Se[n] = p.Se;
+    Sn[n] = p.Sn;
+    Ren[n] = p.Ren;
+  }
+}
+
+GPS_VDataColumns GPS_VDataSoA::columns() const
+{
+  const float *base = m_data.data() + m_offset;
+  return {m_count,
+          base,
+          base + m_stride,
+          base + 2 * m_stride,
+          base + 3 * m_stride,
+          base + 4 * m_stride,
+          base + 5 * m_stride,
+          base + 6 * m_stride};
+}
@@ -0,0 +1,82 @@
+#ifndef _PNW_ROTATION_GPS_DATA_H_
+#define _PNW_ROTATION_GPS_DATA_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct mapBounds
+{
+  float minLat = 41.0;
+  float maxLat = 50.0;
+  float minLon = 236.0;
+  float maxLon = 250.0;
+
+  bool contains(float lon, float lat) const
+  {
+    return lat > minLat && lat < maxLat && lon > minLon && lon < maxLon;
+  }
+};
+
+struct GPS_VData_Point
+{
+  float lon;
+  float lat;
+  float Ve;
+  float Vn;
+  float Se;
+  float Sn;
+  float Ren;
+};
+
+// Non-owning structure-of-arrays view of a station set
+struct GPS_VDataColumns
+{
+  size_t count = 0;
+  const float *lon = nullptr;
+  const float *lat = nullptr;
+  const float *Ve = nullptr;
+  const float *Vn = nullptr;
+  const float *Se = nullptr;
+  const float *Sn = nullptr;
+  const float *Ren = nullptr;
+};
+
+// Owning structure-of-arrays station container, one 64 byte aligned
+// float column per field so kernels can stream each field contiguously
+class GPS_VDataSoA
+{
+public:
+  GPS_VDataSoA() = default;
+  explicit GPS_VDataSoA(const std::vector<GPS_VData_Point> &gpsData) { assign(gpsData); }
+
+  void assign(const std::vector<GPS_VData_Point> &gpsData);
+  size_t size() const { return m_count; }
+  GPS_VDataColumns columns() const;
+
+private:
+  std::vector<float> m_data; // 7 columns of m_stride floats, column 0 starts at m_offset
+  size_t m_count = 0;
+  size_t m_stride = 0;
+  size_t m_offset = 0;
+};
+
+// Line counts from one pass over an NSHM velocity file
+struct GPS_ParseStats
+{
+  int lines = 0;     // total lines including comments and blanks
+  int accepted = 0;  // stations inside the bounds
+  int rejected = 0;  // well formed stations outside the bounds
+  int malformed = 0; // data lines without exactly 7 numeric columns
+  std::vector<int> malformedLines; // 1 based line numbers, first few only
+};
+
+// Memory map an NSHM GPS velocity file (lon lat Ve Vn Se Sn Ren per line,
+// '//' comments) and parse it in place, keeping stations inside bounds.
+bool parseGpsDataFile(
+    const std::string &filename,
+    const mapBounds &bounds,
+    std::vector<GPS_VData_Point> &gpsData,
+    GPS_ParseStats *stats = nullptr);
+
+#endif
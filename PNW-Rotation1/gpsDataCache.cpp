@@ -0,0 +1,249 @@
+#include "gpsDataCache.h"
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+  const char CACHE_MAGIC[8] = {'P', 'N', 'W', 'G', 'P', 'S', 'C', '\0'};
+  const uint32_t CACHE_VERSION = 1;
+  const size_t COLUMN_ALIGN = 16; // floats, 64 bytes
+
+  static_assert(sizeof(GPS_VData_Point) == GPS_COLUMN_COUNT * sizeof(float), "GPS_VData_Point fields must map 1:1 to cache columns");
+
+  size_t columnStride(size_t count)
+  {
+    return (count + COLUMN_ALIGN - 1) / COLUMN_ALIGN * COLUMN_ALIGN;
+  }
+
+  bool sameBounds(const float stored[4], const mapBounds &bounds)
+  {
+    return stored[0] == bounds.minLat && stored[1] == bounds.maxLat &&
+           stored[2] == bounds.minLon && stored[3] == bounds.maxLon;
+  }
+
+  // Per writer temp name so concurrent runs never share a partial file
+  std::string tempFileName(const std::string &cacheFile)
+  {
+    std::random_device device;
+    const uint64_t salt = ((uint64_t)device() << 32 | device()) ^
+                          (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    std::ostringstream name;
+    name << cacheFile << "." << std::hex << salt << ".tmp";
+    return name.str();
+  }
+}
+
+uint64_t hashFile(const std::string &filename)
+{
+  MappedFile file;
+  if (!file.open(filename))
+    return 0;
+
+  uint64_t hash = 14695981039346656037ull;
+  const unsigned char *p = (const unsigned char *)file.data();
+  for (size_t n = 0; n < file.size(); n++)
+  {
+    hash ^= p[n];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string GpsDataCache::cacheFileName(const std::string &sourceFile)
+{
+  return sourceFile + ".gpsc";
+}
+
+bool GpsDataCache::load(const std::string &sourceFile, const mapBounds &bounds)
+{
+  m_file.close();
+  m_memory.clear();
+  m_count = 0;
+  m_fromCache = false;
+
+  std::error_code ec;
+  const uint64_t sourceSize = std::filesystem::file_size(sourceFile, ec);
+  if (ec)
+  {
+    std::cerr << "Error: Could not open file " << sourceFile << std::endl;
+    return false;
+  }
+  const int64_t sourceTime = std::filesystem::last_write_time(sourceFile, ec).time_since_epoch().count();
+
+  const std::string cacheFile = cacheFileName(sourceFile);
+  if (openCache(cacheFile, sourceFile, bounds, sourceSize, sourceTime))
+  {
+    m_fromCache = true;
+    return true;
+  }
+
+  // Stale or missing - parse the text and rebuild
+  std::vector<GPS_VData_Point> gpsData;
+  if (!parseGpsDataFile(sourceFile, bounds, gpsData))
+    return false;
+
+  if (writeCache(cacheFile, gpsData, bounds, sourceSize, sourceTime, hashFile(sourceFile)) &&
+      openCache(cacheFile, sourceFile, bounds, sourceSize, sourceTime))
+    return true;
+
+  std::cerr << "Warning: Could not write cache " << cacheFile << std::endl;
+  const size_t stride = columnStride(gpsData.size());
+  m_memory.assign(stride * GPS_COLUMN_COUNT, 0.0f);
+  for (size_t n = 0; n < gpsData.size(); n++)
+  {
+    const float *v = &gpsData[n].lon;
+    for (int c = 0; c < GPS_COLUMN_COUNT; c++)
+      m_memory[c * stride + n] = v[c];
+  }
+  setColumns(m_memory.data(), gpsData.size(), stride);
+  return true;
+}
+
+bool GpsDataCache::openCache(const std::string &cacheFile, const std::string &sourceFile, const mapBounds &bounds,
+                             uint64_t sourceSize, int64_t sourceTime)
+{
+  if (!std::filesystem::exists(cacheFile) || !m_file.open(cacheFile))
+    return false;
+
+  Header header;
+  if (m_file.size() < HEADER_BYTES)
+  {
+    m_file.close();
+    return false;
+  }
+  memcpy(&header, m_file.data(), sizeof(Header));
+
+  bool valid = memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+               header.version == CACHE_VERSION &&
+               header.columns == GPS_COLUMN_COUNT &&
+               header.stride == columnStride(header.count) &&
+               m_file.size() >= HEADER_BYTES + header.stride * GPS_COLUMN_COUNT * sizeof(float) &&
+               header.sourceSize == sourceSize &&
+               sameBounds(header.bounds, bounds);
+
+  // A touched but unchanged source still matches on content. The new time
+  // is stored so later loads skip the hash; the mapping is released first
+  // as Win32 maps deny writers.
+  bool touched = false;
+  if (valid && header.sourceTime != sourceTime)
+    valid = touched = header.sourceHash == hashFile(sourceFile);
+
+  if (!valid)
+  {
+    m_file.close();
+    return false;
+  }
+
+  if (touched)
+  {
+    m_file.close();
+    updateSourceTime(cacheFile, sourceTime);
+    if (!m_file.open(cacheFile) || m_file.size() < HEADER_BYTES + header.stride * GPS_COLUMN_COUNT * sizeof(float))
+    {
+      m_file.close();
+      return false;
+    }
+  }
+
+  setColumns((const float *)(m_file.data() + HEADER_BYTES), header.count, header.stride);
+  return true;
+}
+
+bool GpsDataCache::writeCache(const std::string &cacheFile, const std::vector<GPS_VData_Point> &gpsData, const mapBounds &bounds,
+                              uint64_t sourceSize, int64_t sourceTime, uint64_t sourceHash)
+{
+  Header header = {};
+  memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = CACHE_VERSION;
+  header.columns = GPS_COLUMN_COUNT;
+  header.count = gpsData.size();
+  header.stride = columnStride(gpsData.size());
+  header.sourceSize = sourceSize;
+  header.sourceTime = sourceTime;
+  header.sourceHash = sourceHash;
+  header.bounds[0] = bounds.minLat;
+  header.bounds[1] = bounds.maxLat;
+  header.bounds[2] = bounds.minLon;
+  header.bounds[3] = bounds.maxLon;
+
+  // Write beside the target then rename so readers never map a partial file
+  const std::string tmpFile = tempFileName(cacheFile);
+  bool written = false;
+  {
+    std::ofstream file(tmpFile, std::ios::binary | std::ios::trunc);
+    if (file.is_open())
+    {
+      char headerBytes[HEADER_BYTES] = {};
+      memcpy(headerBytes, &header, sizeof(Header));
+      file.write(headerBytes, HEADER_BYTES);
+
+      std::vector<float> column(header.stride, 0.0f);
+      for (int c = 0; c < GPS_COLUMN_COUNT; c++)
+      {
+        for (size_t n = 0; n < gpsData.size(); n++)
+          column[n] = (&gpsData[n].lon)[c];
+        file.write((const char *)column.data(), column.size() * sizeof(float));
+      }
+
+      // Checked after close so a short final flush (disk full) fails too
+      file.close();
+      written = !file.fail();
+    }
+  }
+
+  std::error_code ec;
+  if (written)
+  {
+    m_file.close(); // release a stale mapping before replacing it
+    std::filesystem::rename(tmpFile, cacheFile, ec);
+  }
+  if (!written || ec)
+  {
+    std::filesystem::remove(tmpFile, ec);
+    return false;
+  }
+  return true;
+}
+
+bool GpsDataCache::updateSourceTime(const std::string &cacheFile, int64_t sourceTime)
+{
+  std::fstream file(cacheFile, std::ios::binary | std::ios::in | std::ios::out);
+  if (!file.is_open())
+    return false;
+  file.seekp(offsetof(Header, sourceTime));
+  file.write((const char *)&sourceTime, sizeof(sourceTime));
+  return file.good();
+}
+
+void GpsDataCache::setColumns(const float *base, size_t count, size_t stride)
+{
+  for (int c = 0; c < GPS_COLUMN_COUNT; c++)
+    m_columns[c] = base + c * stride;
+  m_count = count;
+}
+
+GPS_VDataColumns GpsDataCache::columns() const
+{
+  return {m_count,
+          m_columns[GPS_LON],
+          m_columns[GPS_LAT],
+          m_columns[GPS_VE],
+          m_columns[GPS_VN],
+          m_columns[GPS_SE],
+          m_columns[GPS_SN],
+          m_columns[GPS_REN]};
+}
+
+void GpsDataCache::toPoints(std::vector<GPS_VData_Point> &gpsData) const
+{
+  gpsData.resize(m_count);
+  for (size_t n = 0; n < m_count; n++)
+    gpsData[n] = {m_columns[GPS_LON][n], m_columns[GPS_LAT][n], m_columns[GPS_VE][n], m_columns[GPS_VN][n],
+                  m_columns[GPS_SE][n], m_columns[GPS_SN][n], m_columns[GPS_REN][n]};
+}
@@ -0,0 +1,74 @@
+#ifndef _PNW_ROTATION_GPS_DATA_CACHE_H_
+#define _PNW_ROTATION_GPS_DATA_CACHE_H_
+
+#include "gpsData.h"
+#include "mappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum GPS_Column
+{
+  GPS_LON = 0,
+  GPS_LAT,
+  GPS_VE,
+  GPS_VN,
+  GPS_SE,
+  GPS_SN,
+  GPS_REN,
+  GPS_COLUMN_COUNT
+};
+
+// Binary column (SoA) cache of a parsed NSHM velocity file.
+// The cache lives next to the source as <source>.gpsc. It holds a header
+// with the source size, time and hash plus the bounds used, then one
+// 64 byte aligned float column per field. A valid cache is memory mapped
+// as is; a missing or stale one (source changed, other bounds) is rebuilt
+// from the text file and written back.
+class GpsDataCache
+{
+public:
+  bool load(const std::string &sourceFile, const mapBounds &bounds);
+
+  size_t size() const { return m_count; }
+  bool fromCache() const { return m_fromCache; }
+  const float *column(GPS_Column c) const { return m_columns[c]; }
+  GPS_VDataColumns columns() const;
+
+  void toPoints(std::vector<GPS_VData_Point> &gpsData) const;
+
+  static std::string cacheFileName(const std::string &sourceFile);
+
+private:
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;
+    uint64_t count;
+    uint64_t stride; // floats per column including padding
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    float bounds[4]; // minLat maxLat minLon maxLon
+  };
+  static const size_t HEADER_BYTES = 128;
+
+  MappedFile m_file;
+  std::vector<float> m_memory; // fallback when the cache can't be written
+  const float *m_columns[GPS_COLUMN_COUNT] = {};
+  size_t m_count = 0;
+  bool m_fromCache = false;
+
+  bool openCache(const std::string &cacheFile, const std::string &sourceFile, const mapBounds &bounds,
+                 uint64_t sourceSize, int64_t sourceTime);
+  bool writeCache(const std::string &cacheFile, const std::vector<GPS_VData_Point> &gpsData, const mapBounds &bounds,
+                  uint64_t sourceSize, int64_t sourceTime, uint64_t sourceHash);
+  bool updateSourceTime(const std::string &cacheFile, int64_t sourceTime);
+  void setColumns(const float *base, size_t count, size_t stride);
+};
+
+// FNV-1a 64 bit hash of a file's contents, 0 if it can't be read
+uint64_t hashFile(const std::string &filename);
+
+#endif
@@ -0,0 +1,71 @@
+#include "gpsTransform.h"
+#include <iostream>
+#include "gpsDataCache.h"
+#include "normalEquations.h"
+
+const mapBounds gpsBounds;
+
+bool readDataFile(const std::string &filename, std::vector<GPS_VData_Point> &gpsData)
+{
+  // Parsed columns are cached beside the text file and mapped on later runs
+  GpsDataCache cache;
+  if (!cache.load(filename, gpsBounds))
+    return false;
+
+  cache.toPoints(gpsData);
+  std::cout << "Loaded " << gpsData.size() << " points" << (cache.fromCache() ? " from cache\n" : "\n");
+  return true;
+}
+
+bool getTransform12(
+    std::vector<GPS_VData_Point> &pArray,
+    Eigen::Vector4f &xVector,
+    float *R2)
+{
+  xVector.setZero();
+  const int N = pArray.size();
+  if (N < 4) // need at least 4 samples to regress
+    return false;
+
+  // Starting center point estimation
+  float cx = (gpsBounds.maxLon + gpsBounds.minLon) / 2.0f;
+  float cy = (gpsBounds.maxLat + gpsBounds.minLat) / 2.0f;
+
+  // Stream stations straight into the 4x4 normal equations, no 2N x 4 J or 2N W
+  NormalEquations4 ne;
+  for (const GPS_VData_Point &p : pArray)
+    addTransform12Point(ne, p, cx, cy);
+
+  return solveTransform12(ne, cx, cy, xVector, R2);
+};
+
+bool getTransform12(
+    const GPS_VDataColumns &columns,
+    Eigen::Vector4f &xVector,
+    float *R2,
+    SimdLevel level)
+{
+  xVector.setZero();
+  if (columns.count < 4) // need at least 4 samples to regress
+    return false;
+
+  float cx = (gpsBounds.maxLon + gpsBounds.minLon) / 2.0f;
+  float cy = (gpsBounds.maxLat + gpsBounds.minLat) / 2.0f;
+
+  NormalEquations4 ne;
+  accumulateTransform12(columns, cx, cy, ne, level);
+  return solveTransform12(ne, cx, cy, xVector, R2);
+}
+
+bool getTransform12(
+    const GPS_VDataColumns &columns,
+    Eigen::Vector4f &xVector,
+    float *R2,
+    const RobustParams &robust,
+    std::vector<float> *stationWeights,
+    RobustResult *result)
+{
+  float cx = (gpsBounds.maxLon + gpsBounds.minLon) / 2.0f;
+  float cy = (gpsBounds.maxLat + gpsBounds.minLat) / 2.0f;
+  return solveTransform12Robust(columns, cx, cy, robust, xVector, R2, stationWeights, result);
+}
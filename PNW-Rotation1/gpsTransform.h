@@ -0,0 +1,39 @@
+#ifndef _PNW_ROTATION_GPS_TRANSFORM_H_
+#define _PNW_ROTATION_GPS_TRANSFORM_H_
+
+#include <string>
+#include <vector>
+#include "../../eigen-3.4.0/Eigen/Dense"
+#include "gpsData.h"
+#include "transform12.h"
+#include "transformKernel.h"
+
+// Region the GPS stations are loaded and regressed over
+extern const mapBounds gpsBounds;
+
+// Load stations inside gpsBounds, through the binary cache beside the file
+bool readDataFile(const std::string &filename, std::vector<GPS_VData_Point> &gpsData);
+
+// Transform (tx, ty, s, theta) about the center of gpsBounds
+bool getTransform12(
+    std::vector<GPS_VData_Point> &pArray,
+    Eigen::Vector4f &xVector,
+    float *R2);
+
+// SoA overload - runs the vectorized kernel picked for this CPU
+bool getTransform12(
+    const GPS_VDataColumns &columns,
+    Eigen::Vector4f &xVector,
+    float *R2,
+    SimdLevel level = detectSimdLevel());
+
+// Robust (IRLS) overload, stationWeights receives the final per-station weights
+bool getTransform12(
+    const GPS_VDataColumns &columns,
+    Eigen::Vector4f &xVector,
+    float *R2,
+    const RobustParams &robust,
+    std::vector<float> *stationWeights = nullptr,
+    RobustResult *result = nullptr);
+
+#endif
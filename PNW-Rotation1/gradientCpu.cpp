@@ -0,0 +1,155 @@
+#include "gradientCpu.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "parallelFor.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PNW_GRADIENT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  const int BAND_ROWS = 32; // output rows per band
+
+  // Vertical pass of one output row: both the smoothed and the derivative
+  // column sums, written at offset r into buffers padded by r clamped samples
+  void verticalPass(const float *const *rows, const float *smooth, const float *derivative, int taps, int w, int r,
+                    float *smoothRow, float *derivativeRow)
+  {
+    float *s = smoothRow + r;
+    float *d = derivativeRow + r;
+    int i = 0;
+#ifdef PNW_GRADIENT_SSE2
+    for (; i + 4 <= w; i += 4)
+    {
+      __m128 accS = _mm_setzero_ps();
+      __m128 accD = _mm_setzero_ps();
+      for (int k = 0; k < taps; k++)
+      {
+        const __m128 p = _mm_loadu_ps(rows[k] + i);
+        accS = _mm_add_ps(accS, _mm_mul_ps(_mm_set1_ps(smooth[k]), p));
+        accD = _mm_add_ps(accD, _mm_mul_ps(_mm_set1_ps(derivative[k]), p));
+      }
+      _mm_storeu_ps(s + i, accS);
+      _mm_storeu_ps(d + i, accD);
+    }
+#endif
+    for (; i < w; i++)
+    {
+      float accS = 0.0f, accD = 0.0f;
+      for (int k = 0; k < taps; k++)
+      {
+        accS += smooth[k] * rows[k][i];
+        accD += derivative[k] * rows[k][i];
+      }
+      s[i] = accS;
+      d[i] = accD;
+    }
+
+    for (int k = 1; k <= r; k++)
+    {
+      s[-k] = s[0];
+      d[-k] = d[0];
+      s[w - 1 + k] = s[w - 1];
+      d[w - 1 + k] = d[w - 1];
+    }
+  }
+
+  // Horizontal pass: gx from the vertically smoothed row, gy from the
+  // vertical derivative row, interleaved into the float2 output row
+  void horizontalPass(const float *smoothRow, const float *derivativeRow, const float *smooth, const float *derivative,
+                      int taps, int w, float2 *out)
+  {
+    float *o = reinterpret_cast<float *>(out);
+    int i = 0;
+#ifdef PNW_GRADIENT_SSE2
+    for (; i + 4 <= w; i += 4)
+    {
+      __m128 gx = _mm_setzero_ps();
+      __m128 gy = _mm_setzero_ps();
+      for (int k = 0; k < taps; k++)
+      {
+        gx = _mm_add_ps(gx, _mm_mul_ps(_mm_set1_ps(derivative[k]), _mm_loadu_ps(smoothRow + i + k)));
+        gy = _mm_add_ps(gy, _mm_mul_ps(_mm_set1_ps(smooth[k]), _mm_loadu_ps(derivativeRow + i + k)));
+      }
+      _mm_storeu_ps(o + 2 * i, _mm_unpacklo_ps(gx, gy));
+      _mm_storeu_ps(o + 2 * i + 4, _mm_unpackhi_ps(gx, gy));
+    }
+#endif
+    for (; i < w; i++)
+    {
+      float gx = 0.0f, gy = 0.0f;
+      for (int k = 0; k < taps; k++)
+      {
+        gx += derivative[k] * smoothRow[i + k];
+        gy += smooth[k] * derivativeRow[i + k];
+      }
+      o[2 * i] = gx;
+      o[2 * i + 1] = gy;
+    }
+  }
+}
+
+GradientKernel GradientKernel::sobel()
+{
+  return {{0.25f, 0.5f, 0.25f}, {-0.5f, 0.0f, 0.5f}};
+}
+
+GradientKernel GradientKernel::gaussian(float sigma)
+{
+  const int r = std::max(1, (int)std::ceil(3.0f * sigma));
+  GradientKernel kernel;
+  kernel.smooth.resize(2 * r + 1);
+  kernel.derivative.resize(2 * r + 1);
+  float sum = 0.0f, moment = 0.0f;
+  for (int k = -r; k <= r; k++)
+  {
+    const float g = std::exp(-0.5f * k * k / (sigma * sigma));
+    kernel.smooth[k + r] = g;
+    kernel.derivative[k + r] = k * g;
+    sum += g;
+    moment += k * k * g;
+  }
+  for (int k = 0; k <= 2 * r; k++)
+  {
+    kernel.smooth[k] /= sum;
+    kernel.derivative[k] /= moment;
+  }
+  return kernel;
+}
+
+void GradientCpu::Convolve(Image<float2> &gradientImage, Image<float> &image, const GradientKernel &kernel, int threads)
+{
+  const int w = image.Width();
+  const int h = image.Height();
+  if (w <= 0 || h <= 0)
+    return;
+  const int taps = (int)kernel.smooth.size();
+  const int r = kernel.radius();
+  const float *src = image.HData();
+  float2 *dst = gradientImage.HData();
+
+  // One contiguous range of bands per worker so the row buffers are
+  // allocated once per worker and call; rows cost the same, so static
+  // ranges balance
+  const int bands = (h + BAND_ROWS - 1) / BAND_ROWS;
+  const int workers = std::min(bands, threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency()));
+  parallelFor(workers, [&](int worker)
+  {
+    std::vector<float> smoothRow(w + 2 * r), derivativeRow(w + 2 * r);
+    std::vector<const float *> rows(taps);
+
+    const int j0 = (int)((long long)bands * worker / workers) * BAND_ROWS;
+    const int j1 = std::min(h, (int)((long long)bands * (worker + 1) / workers) * BAND_ROWS);
+    for (int j = j0; j < j1; j++)
+    {
+      for (int k = 0; k < taps; k++)
+        rows[k] = src + (size_t)std::clamp(j + k - r, 0, h - 1) * w;
+      verticalPass(rows.data(), kernel.smooth.data(), kernel.derivative.data(), taps, w, r, smoothRow.data(), derivativeRow.data());
+      horizontalPass(smoothRow.data(), derivativeRow.data(), kernel.smooth.data(), kernel.derivative.data(), taps, w, dst + (size_t)j * w);
+    }
+  }, threads);
+}
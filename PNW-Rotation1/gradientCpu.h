@@ -0,0 +1,39 @@
+#ifndef _PNW_ROTATION_GRADIENT_CPU_H_
+#define _PNW_ROTATION_GRADIENT_CPU_H_
+
+#include <vector>
+#include "gaussNewton2D.h"
+
+// Separable gradient kernel, taps run from -radius to radius.
+// gx = derivative (x) smooth (y), gy = smooth (x) derivative (y).
+struct GradientKernel
+{
+  std::vector<float> smooth;     // sums to 1
+  std::vector<float> derivative; // sum k d[k] = 1, so gradients are in intensity per px
+
+  int radius() const { return (int)smooth.size() / 2; }
+
+  // 3x3 Sobel scaled to a unit derivative
+  static GradientKernel sobel();
+  // Gaussian and its derivative, radius ceil(3 sigma)
+  static GradientKernel gaussian(float sigma);
+};
+
+// Multi-threaded CPU gradient for hosts without a GPU, opt in through
+// PyramidParams::cpuGradient (GaussNewtonPyramid and RegistrationSession;
+// levels = 1, maxIterations = 1 is the single step getTransformLSD).
+// The Sobel kernel is scaled to a unit derivative, not to GradientFn's
+// scale; the benchmark reports the ratio.
+// Rows are processed in bands, one contiguous range of bands per core.
+// Each output row is built from one vertical pass (smooth and derivative
+// together) into two row buffers and one horizontal pass that writes the
+// interleaved float2 result, so the input is read once per row and no
+// full size intermediate is kept. Borders are clamped.
+class GradientCpu
+{
+public:
+  static void Convolve(Image<float2> &gradientImage, Image<float> &image,
+                       const GradientKernel &kernel = GradientKernel::sobel(), int threads = 0);
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef _PNW_ROTATION_IMAGE_POOL_H_
+#define _PNW_ROTATION_IMAGE_POOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "gaussNewton2D.h"
+
+// Recycles same sized scratch images between registrations.
+// acquire() hands out an idle image of the requested size, or allocates
+// one, and the image goes back to the pool when its last shared_ptr is
+// released, so a registration loop touches fresh memory only on its first
+// frame. Idle images are kept up to a byte budget, the least recently
+// released go first, and an image larger than the budget is freed at once.
+// Recycled images hold whatever the previous user wrote: callers that do
+// not overwrite every pixel they read must ask for zeroed, which clears a
+// recycled image and leaves a new one as the Image constructor made it.
+template <typename T>
+class ImagePool
+{
+public:
+  static const size_t DEFAULT_IDLE_BYTES = (size_t)256 << 20;
+
+  explicit ImagePool(size_t maxIdleBytes = DEFAULT_IDLE_BYTES) : m_state(std::make_shared<State>())
+  {
+    m_state->maxIdleBytes = maxIdleBytes;
+  }
+
+  ImagePool(const ImagePool &) = delete;
+  ImagePool &operator=(const ImagePool &) = delete;
+
+  std::shared_ptr<Image<T>> acquire(int w, int h, bool zeroed = false)
+  {
+    std::unique_ptr<Image<T>> image;
+    {
+      std::lock_guard<std::mutex> lock(m_state->mutex);
+      std::vector<std::unique_ptr<Image<T>>> &idle = m_state->idle;
+      for (size_t n = idle.size(); n-- > 0;)
+      {
+        if (idle[n]->Width() == w && idle[n]->Height() == h)
+        {
+          image = std::move(idle[n]);
+          idle.erase(idle.begin() + n);
+          m_state->idleBytes -= bytes(*image);
+          break;
+        }
+      }
+    }
+    if (!image)
+      image = std::make_unique<Image<T>>(w, h);
+    else if (zeroed)
+      std::fill(image->HData(), image->HData() + (size_t)w * h, T{});
+
+    // Images outliving the pool are deleted instead of returned
+    std::weak_ptr<State> state = m_state;
+    return std::shared_ptr<Image<T>>(image.release(), [state](Image<T> *released)
+    {
+      std::unique_ptr<Image<T>> owned(released);
+      if (std::shared_ptr<State> s = state.lock())
+      {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (bytes(*owned) <= s->maxIdleBytes)
+        {
+          s->idleBytes += bytes(*owned);
+          s->idle.push_back(std::move(owned));
+          s->trim(s->maxIdleBytes);
+        }
+      }
+    });
+  }
+
+  size_t idleBytes() const
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->idleBytes;
+  }
+
+  // Budget for images kept once released, lowering it trims at once
+  void setIdleBudget(size_t maxIdleBytes)
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->maxIdleBytes = maxIdleBytes;
+    m_state->trim(maxIdleBytes);
+  }
+
+  // Frees idle images down to maxBytes, images in use still come back afterwards
+  void trim(size_t maxBytes = 0)
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->trim(maxBytes);
+  }
+
+  // Pool of the calling thread, e.g. one per RegistrationSession worker
+  static ImagePool &local()
+  {
+    static thread_local ImagePool pool;
+    return pool;
+  }
+
+private:
+  struct State
+  {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Image<T>>> idle; // most recently released last
+    size_t idleBytes = 0;
+    size_t maxIdleBytes = 0;
+
+    // Caller holds the mutex
+    void trim(size_t maxBytes)
+    {
+      size_t drop = 0;
+      for (size_t kept = idleBytes; drop < idle.size() && kept > maxBytes; drop++)
+        kept -= bytes(*idle[drop]);
+      for (size_t n = 0; n < drop; n++)
+        idleBytes -= bytes(*idle[n]);
+      idle.erase(idle.begin(), idle.begin() + drop);
+    }
+  };
+
+  static size_t bytes(Image<T> &image)
+  {
+    return (size_t)image.Width() * image.Height() * sizeof(T);
+  }
+
+  std::shared_ptr<State> m_state;
+};
+
+#endif
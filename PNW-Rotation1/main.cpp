@@ -1,159 +1,75 @@
-#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
-#include <sstream>
-#include <filesystem>
 #include "../../eigen-3.4.0/Eigen/Dense"
-
-#define sqr(x) ((x) * (x))
-
-const struct mapBounds
-{
-  float minLat = 41.0;
-  float maxLat = 50.0;
-  float minLon = 236.0;
-  float maxLon = 250.0;
-} gpsBounds;
-
-struct GPS_VData_Point
-{
-  float lon;
-  float lat;
-  float Ve;
-  float Vn;
-  float Se;
-  float Sn;
-  float Ren;
-} dataPoint;
-
-bool readDataFile(const std::string &filename, std::vector<GPS_VData_Point> &gpsData)
+#include "gpsData.h"
+#include "eulerPole.h"
+#include "gpsDataCache.h"
+#include "gpsTransform.h"
+#include "resampling.h"
+#include "rotationField.h"
+
+// Moving-window field over gpsBounds, one ESRI ASCII grid per band
+void writeRotationField(const GPS_VDataColumns &columns, float step, float radiusKm, const std::string &prefix)
 {
-  std::ifstream file(filename);
+  RotationFieldParams params;
+  params.bounds = gpsBounds;
+  params.step = step;
+  params.radiusKm = radiusKm;
 
-  if (!file.is_open())
+  RotationField field;
+  if (!getRotationField(columns, params, field))
   {
-    std::cerr << "Path: " << std::filesystem::current_path() << std::endl;
-    std::cerr << "Error: Could not open file " << filename << std::endl;
-    return false;
+    std::cerr << "Error: Invalid rotation field parameters" << std::endl;
+    return;
   }
 
-  gpsData.resize(0);
-  std::string line;
-  // Read the file line by line
-  while (std::getline(file, line))
-  {
-    if (line[0] != '/' && line[1] != '/')
-    {
-      std::istringstream iss(line);
-      std::vector<float> entries;
-      float entry;
-
-      // Loop to extract numbers until the end of the stream
-      while (iss >> entry)
-        entries.push_back(entry);
-
-      if (entries.size() == 7)
-      {
-        GPS_VData_Point dataPoint{entries[0], entries[1], entries[2], entries[3], entries[4], entries[5], entries[6]};
-        if (dataPoint.lat > gpsBounds.minLat &&
-            dataPoint.lat < gpsBounds.maxLat &&
-            dataPoint.lon > gpsBounds.minLon &&
-            dataPoint.lon < gpsBounds.maxLon)
-          gpsData.push_back(dataPoint);
-      }
-    }
-  }
-  std::cout << "Loaded " << gpsData.size() << " points\n";
-  file.close();
-  return true;
+  writeRotationFieldBand(field, field.rotation, prefix + "_rotation.asc");
+  writeRotationFieldBand(field, field.dilatation, prefix + "_dilatation.asc");
+  writeRotationFieldBand(field, field.residual, prefix + "_residual.asc");
+  std::cout << "Rotation field " << field.width << " x " << field.height << " written to " << prefix << "_*.asc\n";
 }
 
-bool getTransform12(
-    std::vector<GPS_VData_Point> &pArray,
-    Eigen::Vector4f &xVector,
-    float *R2)
-{
-  xVector.setZero();
-  const int N = pArray.size();
-  if (N < 4) // need at least 4 samples to regress
-    return false;
-
-  // Starting center point estimation
-  float cx = (gpsBounds.maxLon + gpsBounds.minLon) / 2.0f;
-  float cy = (gpsBounds.maxLat + gpsBounds.minLat) / 2.0f;
-
-  // pass2 - process data
-  Eigen::MatrixXf J(2 * N, 4);
-  Eigen::VectorXf R(2 * N);
-  Eigen::VectorXf wt(2 * N);
-
-  int jIdx = 0;
-  for (int n = 0; n < N; n++)
-  {
-    const float u = pArray[n].lon - cx;
-    const float v = pArray[n].lat - cy;
-
-    float wu = 1.0f / sqr(pArray[n].Se);
-    float wv = 1.0f / sqr(pArray[n].Sn);
-    float ru = pArray[n].Ve;
-    float rv = pArray[n].Vn;
-
-    // Calculate Jacobian elements for Dx
-    J(jIdx, 0) = 1.0f; //  dru/dtx
-    J(jIdx, 1) = 0.0f; //  dru/dty
-    J(jIdx, 2) = u;    //  dru/ds
-    J(jIdx, 3) = v;    //  dru/dtheta
-
-    R(jIdx) = ru;  // Dx
-    wt(jIdx) = wu; // wu;
-    jIdx++;
-
-    // Calculate Jacobian elements for Dy
-    J(jIdx, 0) = 0.0f; //  drv/dtx
-    J(jIdx, 1) = 1.0f; //  drv/dty
-    J(jIdx, 2) = v;    //  drv/ds
-    J(jIdx, 3) = u;   //  drv/dtheta
-
-    R(jIdx) = rv;  // Dy
-    wt(jIdx) = wv; // wv;
-    jIdx++;
-  }
-
-  // std::cout << "J: \n" << J << std::endl;
-  // std::cout << "R: \n" << R << std::endl;
-  Eigen::DiagonalMatrix<float, Eigen::Dynamic> W(2 * N);
-  W.diagonal() = wt;
-  Eigen::MatrixXf A = J.transpose() * W * J;
-  // std::cout << "A: \n" << A << std::endl;
-  Eigen::MatrixXf b = -J.transpose() * W * R;
-  // std::cout << "b: \n" << b << std::endl;
-
-  // Residual rms
-  if (R2)
-    *R2 = sqrt(R.transpose() * W * R);
-
-  // xVector = A.inverse() * b;
-  // xVector = A.colPivHouseholderQr().solve(b).col(0);
-  // xVector = (A.transpose() * A).ldlt().solve(A.transpose() * b);
-  xVector = A.colPivHouseholderQr().solve(b);
-
-  xVector[0] += cx;
-  xVector[1] += cy;
-
-  return true;
-};
-
-int main()
+// PNWRotation [field <step deg> <radius km> <output prefix>]
+int main(int argc, char *argv[])
 {
   std::string gpsDataFileName = "./data/nshm2023_wus_v1.txt";
-  std::vector<GPS_VData_Point> gpsData;
-  if (readDataFile(gpsDataFileName, gpsData))
+  GpsDataCache gpsData;
+  if (gpsData.load(gpsDataFileName, gpsBounds))
   {
+    std::cout << "Loaded " << gpsData.size() << " points" << (gpsData.fromCache() ? " from cache\n" : "\n");
+
     Eigen::Vector4f xVector;
     float R2;
-    if (getTransform12(gpsData, xVector, &R2))
+    if (getTransform12(gpsData.columns(), xVector, &R2))
       std::cout << xVector.transpose() << std::endl;
+
+    RobustResult robust;
+    if (getTransform12(gpsData.columns(), xVector, &R2, RobustParams(), nullptr, &robust))
+      std::cout << "Robust " << xVector.transpose() << " (" << robust.iterations << " iterations, "
+                << robust.downweighted << " stations downweighted)" << std::endl;
+
+    // Confidence intervals on scale and rotation
+    float cx = (gpsBounds.maxLon + gpsBounds.minLon) / 2.0f;
+    float cy = (gpsBounds.maxLat + gpsBounds.minLat) / 2.0f;
+    ResampleStats bootstrap, jackknife;
+    if (bootstrapTransform12(gpsData.columns(), cx, cy, BootstrapParams(), bootstrap) &&
+        jackknifeTransform12(gpsData.columns(), cx, cy, 0.95f, jackknife))
+    {
+      std::cout << "Bootstrap 95% s [" << bootstrap.lower[2] << ", " << bootstrap.upper[2] << "]"
+                << " theta [" << bootstrap.lower[3] << ", " << bootstrap.upper[3] << "]\n";
+      std::cout << "Jackknife 95% s [" << jackknife.lower[2] << ", " << jackknife.upper[2] << "]"
+                << " theta [" << jackknife.lower[3] << ", " << jackknife.upper[3] << "]\n";
+    }
+
+    EulerPoleFit pole = EulerPoleSolver(gpsData.columns()).solveAll();
+    if (pole.valid)
+      std::cout << "Euler pole lat " << pole.lat << " +/- " << pole.sigmaLat
+                << " lon " << pole.lon << " +/- " << pole.sigmaLon
+                << " rate " << pole.rate << " +/- " << pole.sigmaRate << " deg/Myr\n";
+
+    if (argc == 5 && std::string(argv[1]) == "field")
+      writeRotationField(gpsData.columns(), std::stof(argv[2]), std::stof(argv[3]), argv[4]);
   }
   return 0;
-};
\ No newline at end of file
+};
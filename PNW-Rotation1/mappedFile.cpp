@@ -0,0 +1,106 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &filename)
+{
+  close();
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size))
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file = file;
+  m_size = (size_t)size.QuadPart;
+  m_open = true;
+  if (m_size == 0)
+    return true;
+
+  m_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (m_mapping)
+    m_data = (const char *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!m_data)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (m_data)
+    UnmapViewOfFile(m_data);
+  if (m_mapping)
+    CloseHandle(m_mapping);
+  if (m_file)
+    CloseHandle(m_file);
+  m_data = nullptr;
+  m_mapping = nullptr;
+  m_file = nullptr;
+  m_size = 0;
+  m_open = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string &filename)
+{
+  close();
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  m_size = (size_t)st.st_size;
+  m_open = true;
+  if (m_size > 0)
+  {
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      ::close(fd);
+      m_size = 0;
+      m_open = false;
+      return false;
+    }
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = (const char *)data;
+  }
+  ::close(fd); // the mapping keeps its own reference
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (m_data)
+    munmap((void *)m_data, m_size);
+  m_data = nullptr;
+  m_size = 0;
+  m_open = false;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef _PNW_ROTATION_MAPPED_FILE_H_
+#define _PNW_ROTATION_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory map of a whole file (POSIX mmap / Win32 file mapping).
+// An empty file opens fine with size() == 0 and data() == nullptr.
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool open(const std::string &filename);
+  void close();
+
+  bool isOpen() const { return m_open; }
+  const char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+  bool m_open = false;
+#ifdef _WIN32
+  void *m_file = nullptr;
+  void *m_mapping = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef _PNW_ROTATION_NORMAL_EQUATIONS_H_
+#define _PNW_ROTATION_NORMAL_EQUATIONS_H_
+
+#include <algorithm>
+#include <vector>
+#include "../../eigen-3.4.0/Eigen/Dense"
+#include "parallelFor.h"
+
+// Streaming weighted normal equations for the 4 parameter
+// (tx, ty, s, theta) transform model.
+// Each observation row j (Jacobian), residual r and weight w is folded
+// straight into J'WJ, J'WR and R'WR so memory stays fixed whatever the
+// sample count. Sums are kept in double so millions of rows don't
+// swamp the float inputs.
+struct NormalEquations4
+{
+  Eigen::Matrix4d JtWJ = Eigen::Matrix4d::Zero(); // upper triangle only until solve
+  Eigen::Vector4d JtWR = Eigen::Vector4d::Zero();
+  double RtWR = 0.0;
+  long long rows = 0;
+
+  void clear()
+  {
+    JtWJ.setZero();
+    JtWR.setZero();
+    RtWR = 0.0;
+    rows = 0;
+  }
+
+  // Add one observation row
+  inline void add(float j0, float j1, float j2, float j3, float r, float w)
+  {
+    const double wj[4] = {w * (double)j0, w * (double)j1, w * (double)j2, w * (double)j3};
+    JtWJ(0, 0) += wj[0] * j0;
+    JtWJ(0, 1) += wj[0] * j1;
+    JtWJ(0, 2) += wj[0] * j2;
+    JtWJ(0, 3) += wj[0] * j3;
+    JtWJ(1, 1) += wj[1] * j1;
+    JtWJ(1, 2) += wj[1] * j2;
+    JtWJ(1, 3) += wj[1] * j3;
+    JtWJ(2, 2) += wj[2] * j2;
+    JtWJ(2, 3) += wj[2] * j3;
+    JtWJ(3, 3) += wj[3] * j3;
+
+    JtWR(0) += wj[0] * r;
+    JtWR(1) += wj[1] * r;
+    JtWR(2) += wj[2] * r;
+    JtWR(3) += wj[3] * r;
+
+    RtWR += (double)w * r * r;
+    rows++;
+  }
+
+  // Merge partial sums (e.g. from another thread or tile)
+  void add(const NormalEquations4 &other)
+  {
+    JtWJ += other.JtWJ;
+    JtWR += other.JtWR;
+    RtWR += other.RtWR;
+    rows += other.rows;
+  }
+
+  Eigen::Matrix4d matrix() const
+  {
+    return JtWJ.selfadjointView<Eigen::Upper>();
+  }
+
+  // Weighted residual norm sqrt(R'WR)
+  float residual() const
+  {
+    return (float)std::sqrt(RtWR);
+  }
+
+  // Weighted squared misfit |R + Jx|^2 for a step x as returned by solve()
+  double chiSquare(const Eigen::Vector4f &x) const
+  {
+    const Eigen::Vector4d xd = x.cast<double>();
+    return std::max(0.0, RtWR + 2.0 * xd.dot(JtWR) + xd.dot(matrix() * xd));
+  }
+
+  // Gauss-Newton step x = -(J'WJ)^-1 J'WR
+  Eigen::Vector4f solve() const
+  {
+    const Eigen::Matrix4d A = matrix();
+    const Eigen::Vector4d b = -JtWR;
+    return A.colPivHouseholderQr().solve(b).cast<float>();
+  }
+};
+
+const int NORMAL_EQUATIONS_TILE_ROWS = 16; // image rows per reduction tile
+
+// Image rows [0, h) reduced on all cores: rowFn(ne, j) folds row j into
+// its tile's normal equations. Tile partials are merged in tile order so
+// the result does not depend on thread scheduling.
+template <typename RowFn>
+NormalEquations4 reduceRows(int h, RowFn &&rowFn, int threads = 0)
+{
+  const int tiles = (h + NORMAL_EQUATIONS_TILE_ROWS - 1) / NORMAL_EQUATIONS_TILE_ROWS;
+  std::vector<NormalEquations4> partial(tiles);
+  parallelFor(tiles, [&](int t)
+  {
+    NormalEquations4 &ne = partial[t];
+    const int j1 = std::min(h, (t + 1) * NORMAL_EQUATIONS_TILE_ROWS);
+    for (int j = t * NORMAL_EQUATIONS_TILE_ROWS; j < j1; j++)
+      rowFn(ne, j);
+  }, threads);
+
+  NormalEquations4 ne;
+  for (const NormalEquations4 &tile : partial)
+    ne.add(tile);
+  return ne;
+}
+
+#endif
@@ -0,0 +1,97 @@
+#include "registrationSession.h"
+#include <algorithm>
+#include "disparityReduction.h"
+#include "displacementFn.h"
+
+RegistrationSession::RegistrationSession(Image<float> &refImage, const RegistrationParams &params)
+    : m_params(params), m_width(refImage.Width()), m_height(refImage.Height())
+{
+  m_refImage = std::make_shared<Image<float>>(m_width, m_height);
+  std::copy(refImage.HData(), refImage.HData() + (size_t)m_width * m_height, m_refImage->HData());
+
+  const int levels = GaussNewtonPyramid::levelCount(m_width, m_height, m_params.pyramid);
+  m_refPyramid.build(*m_refImage, levels, m_params.pyramid.useGpu, m_params.pyramid.threads, m_params.pyramid.cpuGradient);
+  m_pool = std::make_unique<ThreadPool>(m_params.frameThreads);
+}
+
+RegistrationSession::RegistrationSession(Image<float> &refLaplacian, Image<float2> &refGradient, float sigma,
+                                         const RegistrationParams &params)
+    : m_params(params), m_width(refLaplacian.Width()), m_height(refLaplacian.Height()), m_sigma(sigma)
+{
+  m_refDisplacement = std::make_shared<Image<float4>>();
+  DisplacementFn::getDisplacement(*m_refDisplacement, refLaplacian, refGradient, sigma);
+  m_pool = std::make_unique<ThreadPool>(m_params.frameThreads);
+}
+
+RegistrationSession::~RegistrationSession()
+{
+  m_pool.reset();
+}
+
+RegistrationResult RegistrationSession::registerFrame(Image<float> &frameImage) const
+{
+  return registerImage(frameImage, m_params.pyramid.threads);
+}
+
+RegistrationResult RegistrationSession::registerFrame(Image<float> &frameLaplacian, Image<float2> &frameGradient) const
+{
+  return registerDisplacement(frameLaplacian, frameGradient, m_params.pyramid.threads);
+}
+
+std::future<RegistrationResult> RegistrationSession::submit(Image<float> &frameImage)
+{
+  const int threads = m_pool->size() > 1 ? 1 : m_params.pyramid.threads;
+  return m_pool->submit([this, &frameImage, threads]() { return registerImage(frameImage, threads); });
+}
+
+std::future<RegistrationResult> RegistrationSession::submit(Image<float> &frameLaplacian, Image<float2> &frameGradient)
+{
+  const int threads = m_pool->size() > 1 ? 1 : m_params.pyramid.threads;
+  return m_pool->submit([this, &frameLaplacian, &frameGradient, threads]()
+                        { return registerDisplacement(frameLaplacian, frameGradient, threads); });
+}
+
+std::vector<RegistrationResult> RegistrationSession::registerFrames(const std::vector<Image<float> *> &frames)
+{
+  std::vector<std::future<RegistrationResult>> pending;
+  pending.reserve(frames.size());
+  for (Image<float> *frame : frames)
+    pending.push_back(submit(*frame));
+
+  std::vector<RegistrationResult> results;
+  results.reserve(frames.size());
+  for (std::future<RegistrationResult> &result : pending)
+    results.push_back(result.get());
+  return results;
+}
+
+RegistrationResult RegistrationSession::registerImage(Image<float> &frameImage, int threads) const
+{
+  RegistrationResult result;
+  if (!m_refImage || frameImage.Width() != m_width || frameImage.Height() != m_height)
+    return result;
+
+  PyramidParams params = m_params.pyramid;
+  params.threads = threads;
+  ImagePyramid frame;
+  frame.build(frameImage, m_refPyramid.levels(), params.useGpu, threads, params.cpuGradient);
+  result.X = GaussNewtonPyramid::getTransformLSD(m_refPyramid, frame, &result.R2, params, &result.pyramid);
+  return result;
+}
+
+// GaussNewton2D::getTransform12 with the reference displacement read from
+// the session, the frame displacement is evaluated per pixel in each tile
+RegistrationResult RegistrationSession::registerDisplacement(Image<float> &frameLaplacian, Image<float2> &frameGradient, int threads) const
+{
+  RegistrationResult result;
+  if (!m_refDisplacement ||
+      frameLaplacian.Width() != m_width || frameLaplacian.Height() != m_height ||
+      frameGradient.Width() != m_width || frameGradient.Height() != m_height)
+    return result;
+
+  NormalEquations4 ne = reduceDisparity(DisplacementSource::image(m_refDisplacement->HData()),
+                                        DisplacementSource::fields(frameLaplacian.HData(), frameGradient.HData()),
+                                        m_width, m_height, m_sigma, threads);
+  result.X = solveDisparityTransform(ne, &result.R2);
+  return result;
+}
@@ -0,0 +1,75 @@
+#ifndef _PNW_ROTATION_REGISTRATION_SESSION_H_
+#define _PNW_ROTATION_REGISTRATION_SESSION_H_
+
+#include <future>
+#include <memory>
+#include <vector>
+#include "gaussNewtonPyramid.h"
+#include "threadPool.h"
+
+struct RegistrationParams
+{
+  PyramidParams pyramid;   // levels = 1, maxIterations = 1 gives the single step getTransformLSD
+  int frameThreads = 0;    // concurrent frames, 0 - all cores
+};
+
+struct RegistrationResult
+{
+  float4 X{0.0f, 0.0f, 0.0f, 0.0f}; // tx, ty, s, theta about the image center
+  float R2 = 0.0f;
+  PyramidResult pyramid;            // image sessions only
+};
+
+// Registers a stream of frames against one reference.
+// The reference-side products - the image pyramid with its gradients, or
+// the displacement image for the laplacian / gradient form - are computed
+// once when the session is created. Frames then cost only their own side
+// and run concurrently on the session's thread pool, each single threaded
+// inside so the pool does not oversubscribe the cores.
+class RegistrationSession
+{
+public:
+  // GaussNewtonPyramid::getTransformLSD against refImage (copied)
+  explicit RegistrationSession(Image<float> &refImage, const RegistrationParams &params = RegistrationParams());
+
+  // GaussNewton2D::getTransform12 against a reference laplacian / gradient
+  RegistrationSession(Image<float> &refLaplacian, Image<float2> &refGradient, float sigma,
+                      const RegistrationParams &params = RegistrationParams());
+
+  // Waits for frames still queued
+  ~RegistrationSession();
+
+  int width() const { return m_width; }
+  int height() const { return m_height; }
+
+  // One frame on the calling thread, with all cores inside the registration
+  RegistrationResult registerFrame(Image<float> &frameImage) const;
+  RegistrationResult registerFrame(Image<float> &frameLaplacian, Image<float2> &frameGradient) const;
+
+  // Queued on the pool, frames must stay alive until their result is ready
+  std::future<RegistrationResult> submit(Image<float> &frameImage);
+  std::future<RegistrationResult> submit(Image<float> &frameLaplacian, Image<float2> &frameGradient);
+
+  // Every frame on the pool, results in input order
+  std::vector<RegistrationResult> registerFrames(const std::vector<Image<float> *> &frames);
+
+private:
+  RegistrationResult registerImage(Image<float> &frameImage, int threads) const;
+  RegistrationResult registerDisplacement(Image<float> &frameLaplacian, Image<float2> &frameGradient, int threads) const;
+
+  RegistrationParams m_params;
+  int m_width = 0;
+  int m_height = 0;
+
+  // Image sessions
+  std::shared_ptr<Image<float>> m_refImage;
+  ImagePyramid m_refPyramid;
+
+  // Laplacian / gradient sessions
+  std::shared_ptr<Image<float4>> m_refDisplacement;
+  float m_sigma = 0.0f;
+
+  std::unique_ptr<ThreadPool> m_pool; // last, so it drains before the reference goes
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "resampling.h"
+#include "parallelFor.h"
+#include "transform12.h"
+#include "transformKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+  // splitmix64 - decorrelates consecutive replicate seeds
+  uint64_t mixSeed(uint64_t x)
+  {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+  }
+
+  // Inverse standard normal CDF (Acklam), |error| < 1.2e-9
+  double normalQuantile(double p)
+  {
+    const double a[6] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                         1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    const double b[5] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                         6.680131188771972e+01, -1.328068155288572e+01};
+    const double c[6] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                         -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    const double d[4] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                         3.754408661907416e+00};
+    const double pLow = 0.02425;
+
+    if (p <= 0.0 || p >= 1.0)
+      return 0.0;
+    if (p < pLow)
+    {
+      const double q = std::sqrt(-2 * std::log(p));
+      return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+             ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if (p > 1 - pLow)
+      return -normalQuantile(1 - p);
+
+    const double q = p - 0.5;
+    const double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+  }
+
+  void meanAndSpread(const std::vector<Eigen::Vector4f> &x, ResampleStats &stats)
+  {
+    Eigen::Vector4d sum = Eigen::Vector4d::Zero();
+    for (const Eigen::Vector4f &v : x)
+      sum += v.cast<double>();
+    const Eigen::Vector4d mean = sum / (double)x.size();
+
+    Eigen::Vector4d ss = Eigen::Vector4d::Zero();
+    for (const Eigen::Vector4f &v : x)
+      ss += (v.cast<double>() - mean).cwiseAbs2();
+
+    stats.samples = (int)x.size();
+    stats.mean = mean.cast<float>();
+    stats.stddev = (ss / std::max<double>(1, x.size() - 1)).cwiseSqrt().cast<float>();
+  }
+}
+
+bool bootstrapTransform12(
+    const GPS_VDataColumns &data,
+    float cx,
+    float cy,
+    const BootstrapParams &params,
+    ResampleStats &stats,
+    std::vector<Eigen::Vector4f> *replicates)
+{
+  stats = ResampleStats();
+  const size_t N = data.count;
+  if (N < 4 || params.samples < 2) // need at least 4 samples to regress
+    return false;
+
+  NormalEquations4 full;
+  accumulateTransform12(data, cx, cy, full);
+  if (!solveTransform12(full, cx, cy, stats.estimate, nullptr))
+    return false;
+
+  std::vector<Eigen::Vector4f> x(params.samples);
+  parallelFor(params.samples, [&](int b)
+  {
+    // Multiplicity of each station in this replicate, folded in as a row weight
+    std::mt19937_64 rng(mixSeed(params.seed ^ mixSeed((uint64_t)b)));
+    std::uniform_int_distribution<size_t> pick(0, N - 1);
+    std::vector<uint16_t> count(N, 0);
+    for (size_t k = 0; k < N; k++)
+      count[pick(rng)]++;
+
+    NormalEquations4 ne;
+    for (size_t n = 0; n < N; n++)
+      if (count[n])
+        addTransform12Row(ne, data.lon[n], data.lat[n], data.Ve[n], data.Vn[n], data.Se[n], data.Sn[n], cx, cy, count[n]);
+    ne.rows = 2 * (long long)N;
+
+    solveTransform12(ne, cx, cy, x[b], nullptr);
+  }, params.threads);
+
+  meanAndSpread(x, stats);
+
+  // Percentile interval per parameter
+  const float alpha = (1.0f - params.confidence) / 2.0f;
+  std::vector<float> column(x.size());
+  for (int p = 0; p < 4; p++)
+  {
+    for (size_t b = 0; b < x.size(); b++)
+      column[b] = x[b][p];
+    std::sort(column.begin(), column.end());
+    const size_t lo = (size_t)std::floor(alpha * (column.size() - 1));
+    const size_t hi = (size_t)std::ceil((1.0f - alpha) * (column.size() - 1));
+    stats.lower[p] = column[lo];
+    stats.upper[p] = column[std::min(hi, column.size() - 1)];
+  }
+
+  if (replicates)
+    replicates->swap(x);
+  return true;
+}
+
+bool jackknifeTransform12(
+    const GPS_VDataColumns &data,
+    float cx,
+    float cy,
+    float confidence,
+    ResampleStats &stats,
+    int threads)
+{
+  stats = ResampleStats();
+  const size_t N = data.count;
+  if (N < 5) // leave-one-out still needs 4 samples
+    return false;
+
+  NormalEquations4 full;
+  accumulateTransform12(data, cx, cy, full);
+  if (!solveTransform12(full, cx, cy, stats.estimate, nullptr))
+    return false;
+
+  std::vector<Eigen::Vector4f> x(N);
+  parallelFor((int)N, [&](int n)
+  {
+    NormalEquations4 ne = full;
+    addTransform12Row(ne, data.lon[n], data.lat[n], data.Ve[n], data.Vn[n], data.Se[n], data.Sn[n], cx, cy, -1.0f);
+    ne.rows -= 4; // two rows added with negative weight remove two rows
+    solveTransform12(ne, cx, cy, x[n], nullptr);
+  }, threads);
+
+  meanAndSpread(x, stats);
+
+  // Jackknife variance (N-1)/N sum (x_i - mean)^2
+  const float inflate = std::sqrt((float)(N - 1) * (float)(N - 1) / (float)N);
+  stats.stddev *= inflate;
+
+  const float z = (float)normalQuantile(0.5 + confidence / 2.0);
+  stats.lower = stats.estimate - z * stats.stddev;
+  stats.upper = stats.estimate + z * stats.stddev;
+  return true;
+}
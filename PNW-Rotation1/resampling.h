@@ -0,0 +1,50 @@
+#ifndef _PNW_ROTATION_RESAMPLING_H_
+#define _PNW_ROTATION_RESAMPLING_H_
+
+#include "gpsData.h"
+#include "../../eigen-3.4.0/Eigen/Dense"
+#include <cstdint>
+#include <vector>
+
+// Spread of the transform parameters (tx, ty, s, theta) over resamples
+struct ResampleStats
+{
+  int samples = 0;
+  Eigen::Vector4f estimate = Eigen::Vector4f::Zero(); // full data solve
+  Eigen::Vector4f mean = Eigen::Vector4f::Zero();
+  Eigen::Vector4f stddev = Eigen::Vector4f::Zero();
+  Eigen::Vector4f lower = Eigen::Vector4f::Zero();    // confidence interval bounds
+  Eigen::Vector4f upper = Eigen::Vector4f::Zero();
+};
+
+struct BootstrapParams
+{
+  int samples = 1000;
+  uint64_t seed = 1;
+  float confidence = 0.95f;
+  int threads = 0; // 0 - all cores
+};
+
+// Station bootstrap of solveTransform12 about (cx, cy), percentile intervals.
+// Replicate b always draws from its own RNG stream derived from (seed, b),
+// so results are identical whatever the thread count.
+bool bootstrapTransform12(
+    const GPS_VDataColumns &data,
+    float cx,
+    float cy,
+    const BootstrapParams &params,
+    ResampleStats &stats,
+    std::vector<Eigen::Vector4f> *replicates = nullptr);
+
+// Delete-one jackknife with normal intervals. The full normal equations
+// are built once; each leave-one-out solve removes that station's two rows
+// as a rank-2 downdate, so N estimates cost one pass plus N 4x4 solves.
+bool jackknifeTransform12(
+    const GPS_VDataColumns &data,
+    float cx,
+    float cy,
+    float confidence,
+    ResampleStats &stats,
+    int threads = 0);
+
+#endif
@@ -0,0 +1,103 @@
+#include "rotationField.h"
+#include "parallelFor.h"
+#include "stationGrid.h"
+#include "transform12.h"
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+bool getRotationField(const GPS_VDataColumns &data, const RotationFieldParams &params, RotationField &field)
+{
+  const mapBounds &b = params.bounds;
+  if (params.step <= 0 || params.radiusKm <= 0 || b.maxLon < b.minLon || b.maxLat < b.minLat)
+    return false;
+
+  field.lon0 = b.minLon;
+  field.lat0 = b.minLat;
+  field.step = params.step;
+  field.width = (int)std::floor((b.maxLon - b.minLon) / params.step) + 1;
+  field.height = (int)std::floor((b.maxLat - b.minLat) / params.step) + 1;
+
+  const float NaN = std::numeric_limits<float>::quiet_NaN();
+  const size_t nodes = (size_t)field.nodes();
+  field.tx.assign(nodes, NaN);
+  field.ty.assign(nodes, NaN);
+  field.dilatation.assign(nodes, NaN);
+  field.rotation.assign(nodes, NaN);
+  field.residual.assign(nodes, NaN);
+  field.stations.assign(nodes, 0);
+
+  // Cells about half a window wide keep the candidate set close to the disc
+  StationGrid grid;
+  grid.build(data, std::max(params.step, params.radiusKm / 2.0f / 111.195f));
+  const GPS_VDataColumns sorted = grid.columns();
+
+  const float sigma = params.radiusKm / 2.0f;
+  const float gaussScale = -0.5f / (sigma * sigma);
+
+  // One grid row per task, every node writes only its own output slot
+  parallelFor(field.height, [&](int j)
+  {
+    const float cy = field.lat0 + j * field.step;
+    for (int i = 0; i < field.width; i++)
+    {
+      const float cx = field.lon0 + i * field.step;
+
+      NormalEquations4 ne;
+      int count = 0;
+      grid.forEachWithin(cx, cy, params.radiusKm, [&](int k, float d)
+      {
+        const float weight = params.kernel == FieldKernel::Gaussian ? std::exp(d * d * gaussScale) : 1.0f;
+        addTransform12Row(ne, sorted.lon[k], sorted.lat[k], sorted.Ve[k], sorted.Vn[k], sorted.Se[k], sorted.Sn[k],
+                          cx, cy, weight);
+        count++;
+      });
+
+      const size_t node = (size_t)j * field.width + i;
+      field.stations[node] = count;
+      if (count < std::max(4, params.minStations))
+        continue;
+
+      Eigen::Vector4f x = ne.solve();
+      if (!x.allFinite())
+        continue;
+
+      field.tx[node] = x[0];
+      field.ty[node] = x[1];
+      field.dilatation[node] = x[2];
+      field.rotation[node] = x[3];
+      field.residual[node] = (float)std::sqrt(ne.chiSquare(x) / ne.rows);
+    }
+  }, params.threads);
+
+  return true;
+}
+
+bool writeRotationFieldBand(const RotationField &field, const std::vector<float> &band, const std::string &filename)
+{
+  if ((int)band.size() != field.nodes())
+    return false;
+
+  std::ofstream file(filename);
+  if (!file.is_open())
+    return false;
+
+  const float NODATA = -9999.0f;
+  file << "ncols " << field.width << "\n"
+       << "nrows " << field.height << "\n"
+       << "xllcenter " << field.lon0 << "\n"
+       << "yllcenter " << field.lat0 << "\n"
+       << "cellsize " << field.step << "\n"
+       << "NODATA_value " << NODATA << "\n";
+
+  // ESRI grids run north to south
+  for (int j = field.height - 1; j >= 0; j--)
+  {
+    for (int i = 0; i < field.width; i++)
+    {
+      const float value = band[(size_t)j * field.width + i];
+      file << (std::isfinite(value) ? value : NODATA) << (i + 1 < field.width ? " " : "\n");
+    }
+  }
+  return file.good();
+}
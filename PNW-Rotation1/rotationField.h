@@ -0,0 +1,48 @@
+#ifndef _PNW_ROTATION_ROTATION_FIELD_H_
+#define _PNW_ROTATION_ROTATION_FIELD_H_
+
+#include "gpsData.h"
+#include <string>
+#include <vector>
+
+enum class FieldKernel
+{
+  Uniform,  // every station inside the radius counts fully
+  Gaussian  // exp(-d^2 / 2 sigma^2) with sigma = radius / 2
+};
+
+struct RotationFieldParams
+{
+  mapBounds bounds;            // node extent, nodes sit on minLon/minLat + k * step
+  float step = 0.25f;          // node spacing, deg
+  float radiusKm = 100.0f;     // station window around each node
+  FieldKernel kernel = FieldKernel::Gaussian;
+  int minStations = 4;         // fewer stations leaves the node empty (NaN)
+  int threads = 0;             // 0 - all cores
+};
+
+// Moving-window 4 parameter transform evaluated on a regular lon/lat grid.
+// Each node is a getTransform12 solve centered on the node, so parameters
+// follow its sign convention (x solves R + Jx = 0) without the center offset.
+// Bands are row major with row 0 at minLat.
+struct RotationField
+{
+  float lon0 = 0, lat0 = 0, step = 0;
+  int width = 0, height = 0;
+  std::vector<float> tx;         // translation east, mm/yr
+  std::vector<float> ty;         // translation north, mm/yr
+  std::vector<float> dilatation; // s, mm/yr per deg
+  std::vector<float> rotation;   // theta, mm/yr per deg
+  std::vector<float> residual;   // weighted rms misfit of the window fit
+  std::vector<int> stations;     // stations inside the window
+
+  int nodes() const { return width * height; }
+};
+
+// Evaluate every node in parallel; station lookups go through a StationGrid
+bool getRotationField(const GPS_VDataColumns &data, const RotationFieldParams &params, RotationField &field);
+
+// Write one band as an ESRI ASCII grid (QGIS / GDAL readable)
+bool writeRotationFieldBand(const RotationField &field, const std::vector<float> &band, const std::string &filename);
+
+#endif
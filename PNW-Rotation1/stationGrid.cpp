@@ -0,0 +1,70 @@
+#include "stationGrid.h"
+#include <algorithm>
+#include <cmath>
+
+float distanceKm(float lon1, float lat1, float lon2, float lat2)
+{
+  const double DEG = 0.017453292519943295;
+  const double EARTH_RADIUS_KM = 6371.0;
+  const double sdLat = std::sin((lat2 - lat1) * DEG * 0.5);
+  const double sdLon = std::sin((lon2 - lon1) * DEG * 0.5);
+  const double h = sdLat * sdLat + std::cos(lat1 * DEG) * std::cos(lat2 * DEG) * sdLon * sdLon;
+  return (float)(2.0 * EARTH_RADIUS_KM * std::asin(std::min(1.0, std::sqrt(h))));
+}
+
+void StationGrid::build(const GPS_VDataColumns &data, float cellDeg)
+{
+  const size_t N = data.count;
+  m_cell = cellDeg > 0 ? cellDeg : 1.0f;
+  m_ids.resize(N);
+  m_data.assign(N * 7, 0.0f);
+  if (N == 0)
+  {
+    m_width = m_height = 0;
+    m_cellStart.assign(1, 0);
+    return;
+  }
+
+  float maxLon = data.lon[0], maxLat = data.lat[0];
+  m_lon0 = data.lon[0];
+  m_lat0 = data.lat[0];
+  for (size_t n = 1; n < N; n++)
+  {
+    m_lon0 = std::min(m_lon0, data.lon[n]);
+    m_lat0 = std::min(m_lat0, data.lat[n]);
+    maxLon = std::max(maxLon, data.lon[n]);
+    maxLat = std::max(maxLat, data.lat[n]);
+  }
+  m_width = (int)((maxLon - m_lon0) / m_cell) + 1;
+  m_height = (int)((maxLat - m_lat0) / m_cell) + 1;
+
+  // Counting sort of stations into cells
+  std::vector<int> cellOf(N);
+  m_cellStart.assign((size_t)m_width * m_height + 1, 0);
+  for (size_t n = 0; n < N; n++)
+  {
+    const int i = std::min(m_width - 1, (int)((data.lon[n] - m_lon0) / m_cell));
+    const int j = std::min(m_height - 1, (int)((data.lat[n] - m_lat0) / m_cell));
+    cellOf[n] = j * m_width + i;
+    m_cellStart[cellOf[n] + 1]++;
+  }
+  for (size_t c = 1; c < m_cellStart.size(); c++)
+    m_cellStart[c] += m_cellStart[c - 1];
+
+  std::vector<int> next(m_cellStart.begin(), m_cellStart.end() - 1);
+  const float *src[7] = {data.lon, data.lat, data.Ve, data.Vn, data.Se, data.Sn, data.Ren};
+  for (size_t n = 0; n < N; n++)
+  {
+    const int k = next[cellOf[n]]++;
+    m_ids[k] = (int)n;
+    for (int c = 0; c < 7; c++)
+      m_data[c * N + k] = src[c] ? src[c][n] : 0.0f;
+  }
+}
+
+GPS_VDataColumns StationGrid::columns() const
+{
+  const size_t N = m_ids.size();
+  const float *base = m_data.data();
+  return {N, base, base + N, base + 2 * N, base + 3 * N, base + 4 * N, base + 5 * N, base + 6 * N};
+}
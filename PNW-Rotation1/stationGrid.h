@@ -0,0 +1,72 @@
+#ifndef _PNW_ROTATION_STATION_GRID_H_
+#define _PNW_ROTATION_STATION_GRID_H_
+
+#include "gpsData.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Uniform lon/lat bucket index over a station set.
+// Stations are copied into cell order (CSR layout) so a radius query
+// reads a handful of contiguous runs instead of the whole catalog.
+class StationGrid
+{
+public:
+  void build(const GPS_VDataColumns &data, float cellDeg);
+
+  size_t size() const { return m_ids.size(); }
+
+  // Station columns in cell order; ids() maps back to the source index
+  GPS_VDataColumns columns() const;
+  const std::vector<int> &ids() const { return m_ids; }
+
+  // Visit every station within radiusKm of (lon, lat) as fn(sortedIndex, distKm)
+  template <typename Fn>
+  void forEachWithin(float lon, float lat, float radiusKm, Fn &&fn) const;
+
+private:
+  float m_lon0 = 0, m_lat0 = 0, m_cell = 1;
+  int m_width = 0, m_height = 0;
+  std::vector<int> m_cellStart; // m_width * m_height + 1 offsets into the sorted columns
+  std::vector<int> m_ids;
+  std::vector<float> m_data;    // sorted lon, lat, Ve, Vn, Se, Sn, Ren columns
+};
+
+// Great circle distance (km) on the mean Earth sphere
+float distanceKm(float lon1, float lat1, float lon2, float lat2);
+
+template <typename Fn>
+void StationGrid::forEachWithin(float lon, float lat, float radiusKm, Fn &&fn) const
+{
+  if (m_ids.empty())
+    return;
+
+  const float KM_PER_DEG = 111.195f; // 6371 km sphere
+  const float latReach = radiusKm / KM_PER_DEG;
+  const float cosLat = std::max(0.01f, std::cos((std::abs(lat) + latReach) * 0.0174532925f));
+  const float lonReach = std::min(180.0f, latReach / cosLat);
+
+  const int i0 = std::max(0, (int)std::floor((lon - lonReach - m_lon0) / m_cell));
+  const int i1 = std::min(m_width - 1, (int)std::floor((lon + lonReach - m_lon0) / m_cell));
+  const int j0 = std::max(0, (int)std::floor((lat - latReach - m_lat0) / m_cell));
+  const int j1 = std::min(m_height - 1, (int)std::floor((lat + latReach - m_lat0) / m_cell));
+
+  const size_t n = m_ids.size();
+  const float *sLon = m_data.data();
+  const float *sLat = sLon + n;
+  for (int j = j0; j <= j1; j++)
+  {
+    for (int i = i0; i <= i1; i++)
+    {
+      const int cell = j * m_width + i;
+      for (int k = m_cellStart[cell]; k < m_cellStart[cell + 1]; k++)
+      {
+        const float d = distanceKm(lon, lat, sLon[k], sLat[k]);
+        if (d <= radiusKm)
+          fn(k, d);
+      }
+    }
+  }
+}
+
+#endif
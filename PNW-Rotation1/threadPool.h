@@ -0,0 +1,83 @@
+#ifndef _PNW_ROTATION_THREAD_POOL_H_
+#define _PNW_ROTATION_THREAD_POOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads taking jobs in submission order.
+// Unlike parallelFor the workers live as long as the pool, for streams of
+// independent jobs. The destructor finishes every queued job.
+class ThreadPool
+{
+public:
+  explicit ThreadPool(int threads = 0)
+  {
+    if (threads <= 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int t = 0; t < threads; t++)
+      m_workers.emplace_back([this]() { work(); });
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &worker : m_workers)
+      worker.join();
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  int size() const { return (int)m_workers.size(); }
+
+  template <typename Fn>
+  auto submit(Fn &&fn) -> std::future<decltype(fn())>
+  {
+    using Result = decltype(fn());
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+    std::future<Result> future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_jobs.emplace_back([task]() { (*task)(); });
+    }
+    m_wake.notify_one();
+    return future;
+  }
+
+private:
+  void work()
+  {
+    for (;;)
+    {
+      std::function<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+        if (m_jobs.empty())
+          return;
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+      }
+      job();
+    }
+  }
+
+  std::vector<std::thread> m_workers;
+  std::deque<std::function<void()>> m_jobs;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_stopping = false;
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "transform12.h"
+#include "transformKernel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  float robustWeight(RobustLoss loss, float e, float k)
+  {
+    const float a = std::abs(e);
+    switch (loss)
+    {
+    case RobustLoss::Huber:
+      return a <= k ? 1.0f : k / a;
+    case RobustLoss::Tukey:
+    {
+      if (a >= k)
+        return 0.0f;
+      const float t = 1.0f - (a / k) * (a / k);
+      return t * t;
+    }
+    default:
+      return 1.0f;
+    }
+  }
+
+  // Normalized station residual for the step x (R + Jx convention), rms over Dx and Dy
+  inline float stationResidual(const GPS_VDataColumns &d, size_t n, float cx, float cy, const Eigen::Vector4f &x)
+  {
+    const float u = d.lon[n] - cx;
+    const float v = d.lat[n] - cy;
+    const float eu = (d.Ve[n] + x[0] + u * x[2] + v * x[3]) / d.Se[n];
+    const float ev = (d.Vn[n] + x[1] + v * x[2] + u * x[3]) / d.Sn[n];
+    return std::sqrt(0.5f * (eu * eu + ev * ev));
+  }
+
+  // 1.4826 * median absolute residual, consistent with sigma for normal errors
+  float madScale(std::vector<float> &absE)
+  {
+    if (absE.empty())
+      return 1.0f;
+    auto mid = absE.begin() + absE.size() / 2;
+    std::nth_element(absE.begin(), mid, absE.end());
+    const float scale = 1.4826f * *mid;
+    return scale > 1e-12f ? scale : 1e-12f;
+  }
+}
+
+bool solveTransform12Robust(
+    const GPS_VDataColumns &data,
+    float cx,
+    float cy,
+    const RobustParams &params,
+    Eigen::Vector4f &xVector,
+    float *R2,
+    std::vector<float> *stationWeights,
+    RobustResult *result)
+{
+  RobustResult localResult;
+  RobustResult &res = result ? *result : localResult;
+  res = RobustResult();
+
+  xVector.setZero();
+  const size_t N = data.count;
+  if (N < 4) // need at least 4 samples to regress
+    return false;
+
+  const float k = params.tuning > 0 ? params.tuning : (params.loss == RobustLoss::Tukey ? 4.685f : 1.345f);
+
+  // Ordinary weighted solve to start from
+  NormalEquations4 ne;
+  accumulateTransform12(data, cx, cy, ne);
+  Eigen::Vector4f x = ne.solve();
+
+  std::vector<float> weight(N, 1.0f);
+  std::vector<float> absE;
+  if (params.loss != RobustLoss::None && params.estimateScale)
+  {
+    absE.resize(N);
+    for (size_t n = 0; n < N; n++)
+      absE[n] = stationResidual(data, n, cx, cy, x);
+    res.scale = madScale(absE);
+  }
+
+  for (int it = 0; params.loss != RobustLoss::None && it < params.maxIterations; it++)
+  {
+    // Single pass: residual -> weight -> rank-2 delta into the normal equations
+    for (size_t n = 0; n < N; n++)
+    {
+      const float e = stationResidual(data, n, cx, cy, x);
+      if (!absE.empty())
+        absE[n] = e;
+
+      const float w = robustWeight(params.loss, e / res.scale, k);
+      const float delta = w - weight[n];
+      if (delta != 0.0f)
+      {
+        addTransform12Row(ne, data.lon[n], data.lat[n], data.Ve[n], data.Vn[n], data.Se[n], data.Sn[n], cx, cy, delta);
+        ne.rows -= 2; // a reweight, not new observations
+        weight[n] = w;
+      }
+    }
+
+    const Eigen::Vector4f xNext = ne.solve();
+    res.iterations = it + 1;
+    if (!xNext.allFinite())
+      break;
+
+    const float change = (xNext - x).norm();
+    x = xNext;
+    if (!absE.empty())
+      res.scale = madScale(absE); // scale for the next pass
+    if (change <= params.tolerance * (1.0f + x.norm()))
+    {
+      res.converged = true;
+      break;
+    }
+  }
+  if (params.loss == RobustLoss::None)
+    res.converged = true;
+
+  for (float w : weight)
+    res.downweighted += w < 1.0f;
+  if (stationWeights)
+    stationWeights->swap(weight);
+
+  // Residual rms
+  if (R2)
+    *R2 = ne.residual();
+
+  xVector = x;
+  xVector[0] += cx;
+  xVector[1] += cy;
+  return x.allFinite();
+}
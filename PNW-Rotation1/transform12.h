@@ -0,0 +1,96 @@
+#ifndef _PNW_ROTATION_TRANSFORM12_H_
+#define _PNW_ROTATION_TRANSFORM12_H_
+
+#include "gpsData.h"
+#include "normalEquations.h"
+#include <vector>
+
+// 4 parameter (tx, ty, s, theta) velocity transform shared by the global
+// and the windowed regressions. Station offsets u, v are in degrees from
+// the regression center (cx, cy); weights are 1/S^2 scaled by an optional
+// kernel weight.
+
+// Fold one station into the transform normal equations
+inline void addTransform12Row(NormalEquations4 &ne, float lon, float lat, float Ve, float Vn, float Se, float Sn,
+                              float cx, float cy, float weight = 1.0f)
+{
+  const float u = lon - cx;
+  const float v = lat - cy;
+
+  float wu = weight / (Se * Se);
+  float wv = weight / (Sn * Sn);
+
+  // Jacobian row for Dx: dru/dtx, dru/dty, dru/ds, dru/dtheta
+  ne.add(1.0f, 0.0f, u, v, Ve, wu);
+  // Jacobian row for Dy: drv/dtx, drv/dty, drv/ds, drv/dtheta
+  ne.add(0.0f, 1.0f, v, u, Vn, wv);
+}
+
+inline void addTransform12Point(NormalEquations4 &ne, const GPS_VData_Point &p, float cx, float cy)
+{
+  addTransform12Row(ne, p.lon, p.lat, p.Ve, p.Vn, p.Se, p.Sn, cx, cy);
+}
+
+inline bool solveTransform12(
+    const NormalEquations4 &ne,
+    float cx,
+    float cy,
+    Eigen::Vector4f &xVector,
+    float *R2)
+{
+  xVector.setZero();
+  if (ne.rows < 8) // need at least 4 samples to regress
+    return false;
+
+  // Residual rms
+  if (R2)
+    *R2 = ne.residual();
+
+  xVector = ne.solve();
+
+  xVector[0] += cx;
+  xVector[1] += cy;
+
+  return true;
+}
+
+enum class RobustLoss
+{
+  None,
+  Huber,
+  Tukey
+};
+
+struct RobustParams
+{
+  RobustLoss loss = RobustLoss::Huber;
+  float tuning = 0.0f;        // 0 - 1.345 (Huber) / 4.685 (Tukey), in scale units
+  bool estimateScale = true;  // MAD scale of normalized residuals, else 1 (trust Se/Sn)
+  int maxIterations = 20;
+  float tolerance = 1e-6f;    // step change relative to |x|
+};
+
+struct RobustResult
+{
+  int iterations = 0;
+  bool converged = false;
+  float scale = 1.0f;         // final residual scale
+  int downweighted = 0;       // stations with final weight < 1
+};
+
+// Iteratively reweighted least squares on the same model.
+// Each iteration is one pass over the stations: the station residual under
+// the current x gives a new robust weight and only the weight change is
+// added to the normal equations, so J and W are never rebuilt.
+// stationWeights receives the final robust weight (0..1) per station.
+bool solveTransform12Robust(
+    const GPS_VDataColumns &data,
+    float cx,
+    float cy,
+    const RobustParams &params,
+    Eigen::Vector4f &xVector,
+    float *R2,
+    std::vector<float> *stationWeights = nullptr,
+    RobustResult *result = nullptr);
+
+#endif
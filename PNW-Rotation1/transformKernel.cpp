@@ -0,0 +1,209 @@
+#include "transformKernel.h"
+#include "gpsData.h"
+#include "normalEquations.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PNW_X86 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+void transformSumsScalar(const float *lon, const float *lat, const float *Ve, const float *Vn,
+                         const float *Se, const float *Sn, size_t count, float cx, float cy,
+                         double sums[TRANSFORM_SUMS])
+{
+  for (size_t n = 0; n < count; n++)
+  {
+    const double a = 1.0f / (Se[n] * Se[n]);
+    const double b = 1.0f / (Sn[n] * Sn[n]);
+    const double u = lon[n] - cx;
+    const double v = lat[n] - cy;
+    const double ru = Ve[n];
+    const double rv = Vn[n];
+
+    const double au = a * u, av = a * v;
+    const double bu = b * u, bv = b * v;
+    sums[TS_A] += a;
+    sums[TS_AU] += au;
+    sums[TS_AV] += av;
+    sums[TS_B] += b;
+    sums[TS_BU] += bu;
+    sums[TS_BV] += bv;
+    sums[TS_AUU] += au * u;
+    sums[TS_AVV] += av * v;
+    sums[TS_BUU] += bu * u;
+    sums[TS_BVV] += bv * v;
+    sums[TS_ABUV] += (au + bu) * v;
+    sums[TS_ARU] += a * ru;
+    sums[TS_BRV] += b * rv;
+    sums[TS_S] += au * ru + bv * rv;
+    sums[TS_T] += av * ru + bu * rv;
+    sums[TS_RWR] += a * ru * ru + b * rv * rv;
+  }
+}
+
+#ifdef PNW_X86
+
+namespace
+{
+  inline double hsum(__m128 x)
+  {
+    alignas(16) float f[4];
+    _mm_store_ps(f, x);
+    return ((double)f[0] + f[1]) + ((double)f[2] + f[3]);
+  }
+}
+
+void transformSumsSSE(const float *lon, const float *lat, const float *Ve, const float *Vn,
+                      const float *Se, const float *Sn, size_t count, float cx, float cy,
+                      double sums[TRANSFORM_SUMS])
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 vcx = _mm_set1_ps(cx);
+  const __m128 vcy = _mm_set1_ps(cy);
+  const size_t vecCount = count & ~(size_t)3;
+
+  for (size_t block = 0; block < vecCount; block += TRANSFORM_BLOCK)
+  {
+    const size_t blockEnd = std::min(vecCount, block + TRANSFORM_BLOCK);
+    __m128 acc[TRANSFORM_SUMS];
+    for (int s = 0; s < TRANSFORM_SUMS; s++)
+      acc[s] = _mm_setzero_ps();
+
+    for (size_t n = block; n < blockEnd; n += 4)
+    {
+      const __m128 se = _mm_loadu_ps(Se + n);
+      const __m128 sn = _mm_loadu_ps(Sn + n);
+      const __m128 a = _mm_div_ps(one, _mm_mul_ps(se, se));
+      const __m128 b = _mm_div_ps(one, _mm_mul_ps(sn, sn));
+      const __m128 u = _mm_sub_ps(_mm_loadu_ps(lon + n), vcx);
+      const __m128 v = _mm_sub_ps(_mm_loadu_ps(lat + n), vcy);
+      const __m128 ru = _mm_loadu_ps(Ve + n);
+      const __m128 rv = _mm_loadu_ps(Vn + n);
+
+      const __m128 au = _mm_mul_ps(a, u), av = _mm_mul_ps(a, v);
+      const __m128 bu = _mm_mul_ps(b, u), bv = _mm_mul_ps(b, v);
+      const __m128 aru = _mm_mul_ps(a, ru), brv = _mm_mul_ps(b, rv);
+      acc[TS_A] = _mm_add_ps(acc[TS_A], a);
+      acc[TS_AU] = _mm_add_ps(acc[TS_AU], au);
+      acc[TS_AV] = _mm_add_ps(acc[TS_AV], av);
+      acc[TS_B] = _mm_add_ps(acc[TS_B], b);
+      acc[TS_BU] = _mm_add_ps(acc[TS_BU], bu);
+      acc[TS_BV] = _mm_add_ps(acc[TS_BV], bv);
+      acc[TS_AUU] = _mm_add_ps(acc[TS_AUU], _mm_mul_ps(au, u));
+      acc[TS_AVV] = _mm_add_ps(acc[TS_AVV], _mm_mul_ps(av, v));
+      acc[TS_BUU] = _mm_add_ps(acc[TS_BUU], _mm_mul_ps(bu, u));
+      acc[TS_BVV] = _mm_add_ps(acc[TS_BVV], _mm_mul_ps(bv, v));
+      acc[TS_ABUV] = _mm_add_ps(acc[TS_ABUV], _mm_mul_ps(_mm_add_ps(au, bu), v));
+      acc[TS_ARU] = _mm_add_ps(acc[TS_ARU], aru);
+      acc[TS_BRV] = _mm_add_ps(acc[TS_BRV], brv);
+      acc[TS_S] = _mm_add_ps(acc[TS_S], _mm_add_ps(_mm_mul_ps(aru, u), _mm_mul_ps(brv, v)));
+      acc[TS_T] = _mm_add_ps(acc[TS_T], _mm_add_ps(_mm_mul_ps(aru, v), _mm_mul_ps(brv, u)));
+      acc[TS_RWR] = _mm_add_ps(acc[TS_RWR], _mm_add_ps(_mm_mul_ps(aru, ru), _mm_mul_ps(brv, rv)));
+    }
+
+    for (int s = 0; s < TRANSFORM_SUMS; s++)
+      sums[s] += hsum(acc[s]);
+  }
+
+  transformSumsScalar(lon + vecCount, lat + vecCount, Ve + vecCount, Vn + vecCount,
+                      Se + vecCount, Sn + vecCount, count - vecCount, cx, cy, sums);
+}
+
+namespace
+{
+  bool cpuHasAvx2()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+      return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+    // OS must save the YMM state too
+    return osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+  }
+}
+
+SimdLevel detectSimdLevel()
+{
+  static const SimdLevel level = cpuHasAvx2() ? SimdLevel::AVX2 : SimdLevel::SSE;
+  return level;
+}
+
+#else
+
+void transformSumsSSE(const float *lon, const float *lat, const float *Ve, const float *Vn,
+                      const float *Se, const float *Sn, size_t count, float cx, float cy,
+                      double sums[TRANSFORM_SUMS])
+{
+  transformSumsScalar(lon, lat, Ve, Vn, Se, Sn, count, cx, cy, sums);
+}
+
+SimdLevel detectSimdLevel()
+{
+  return SimdLevel::Scalar;
+}
+
+#endif
+
+const char *simdLevelName(SimdLevel level)
+{
+  switch (level)
+  {
+  case SimdLevel::AVX2:
+    return "AVX2";
+  case SimdLevel::SSE:
+    return "SSE";
+  default:
+    return "Scalar";
+  }
+}
+
+void accumulateTransform12(const GPS_VDataColumns &data, float cx, float cy, NormalEquations4 &ne, SimdLevel level)
+{
+  double s[TRANSFORM_SUMS] = {};
+  switch (level)
+  {
+  case SimdLevel::AVX2:
+    transformSumsAVX2(data.lon, data.lat, data.Ve, data.Vn, data.Se, data.Sn, data.count, cx, cy, s);
+    break;
+  case SimdLevel::SSE:
+    transformSumsSSE(data.lon, data.lat, data.Ve, data.Vn, data.Se, data.Sn, data.count, cx, cy, s);
+    break;
+  default:
+    transformSumsScalar(data.lon, data.lat, data.Ve, data.Vn, data.Se, data.Sn, data.count, cx, cy, s);
+    break;
+  }
+
+  // Dx row [1, 0, u, v], Dy row [0, 1, v, u] - upper triangle
+  ne.JtWJ(0, 0) += s[TS_A];
+  ne.JtWJ(0, 2) += s[TS_AU];
+  ne.JtWJ(0, 3) += s[TS_AV];
+  ne.JtWJ(1, 1) += s[TS_B];
+  ne.JtWJ(1, 2) += s[TS_BV];
+  ne.JtWJ(1, 3) += s[TS_BU];
+  ne.JtWJ(2, 2) += s[TS_AUU] + s[TS_BVV];
+  ne.JtWJ(2, 3) += s[TS_ABUV];
+  ne.JtWJ(3, 3) += s[TS_AVV] + s[TS_BUU];
+
+  ne.JtWR(0) += s[TS_ARU];
+  ne.JtWR(1) += s[TS_BRV];
+  ne.JtWR(2) += s[TS_S];
+  ne.JtWR(3) += s[TS_T];
+
+  ne.RtWR += s[TS_RWR];
+  ne.rows += 2 * (long long)data.count;
+}
@@ -0,0 +1,68 @@
+#ifndef _PNW_ROTATION_TRANSFORM_KERNEL_H_
+#define _PNW_ROTATION_TRANSFORM_KERNEL_H_
+
+#include <cstddef>
+
+// Vectorized weighted sums for the 4 parameter (tx, ty, s, theta) GPS
+// velocity model. Per station, with a = 1/Se^2, b = 1/Sn^2,
+// u = lon - cx, v = lat - cy:
+//   Dx row [1, 0, u, v] residual Ve weight a
+//   Dy row [0, 1, v, u] residual Vn weight b
+// The kernels only produce the 16 distinct sums below; accumulateTransform12
+// (transformKernel.cpp) folds them into NormalEquations4.
+//
+// This header is shared with the AVX2 translation unit, which is compiled
+// with AVX2 code generation - keep it free of inline code.
+enum TransformSum
+{
+  TS_A = 0, // sum a
+  TS_AU,    // sum a u
+  TS_AV,    // sum a v
+  TS_B,     // sum b
+  TS_BU,    // sum b u
+  TS_BV,    // sum b v
+  TS_AUU,   // sum a u^2
+  TS_AVV,   // sum a v^2
+  TS_BUU,   // sum b u^2
+  TS_BVV,   // sum b v^2
+  TS_ABUV,  // sum (a + b) u v
+  TS_ARU,   // sum a Ve
+  TS_BRV,   // sum b Vn
+  TS_S,     // sum a u Ve + b v Vn
+  TS_T,     // sum a v Ve + b u Vn
+  TS_RWR,   // sum a Ve^2 + b Vn^2
+  TRANSFORM_SUMS
+};
+
+enum class SimdLevel
+{
+  Scalar,
+  SSE,
+  AVX2
+};
+
+// Float lanes are flushed to the double sums every block of stations
+const size_t TRANSFORM_BLOCK = 4096;
+
+void transformSumsScalar(const float *lon, const float *lat, const float *Ve, const float *Vn,
+                         const float *Se, const float *Sn, size_t count, float cx, float cy,
+                         double sums[TRANSFORM_SUMS]);
+void transformSumsSSE(const float *lon, const float *lat, const float *Ve, const float *Vn,
+                      const float *Se, const float *Sn, size_t count, float cx, float cy,
+                      double sums[TRANSFORM_SUMS]);
+void transformSumsAVX2(const float *lon, const float *lat, const float *Ve, const float *Vn,
+                       const float *Se, const float *Sn, size_t count, float cx, float cy,
+                       double sums[TRANSFORM_SUMS]);
+
+// Best level this CPU supports, detected once
+SimdLevel detectSimdLevel();
+const char *simdLevelName(SimdLevel level);
+
+struct GPS_VDataColumns;
+struct NormalEquations4;
+
+// Add a station set's Dx/Dy rows to the normal equations, (cx, cy) is the regression center
+void accumulateTransform12(const GPS_VDataColumns &data, float cx, float cy, NormalEquations4 &ne,
+                           SimdLevel level = detectSimdLevel());
+
+#endif
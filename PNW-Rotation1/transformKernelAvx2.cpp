@@ -0,0 +1,84 @@
+// Compiled with AVX2 code generation (see CMakeLists.txt) - only reached
+// through detectSimdLevel() on CPUs that report AVX2.
+#include "transformKernel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace
+{
+  inline double hsum(__m256 x)
+  {
+    alignas(32) float f[8];
+    _mm256_store_ps(f, x);
+    return (((double)f[0] + f[1]) + ((double)f[2] + f[3])) + (((double)f[4] + f[5]) + ((double)f[6] + f[7]));
+  }
+}
+
+void transformSumsAVX2(const float *lon, const float *lat, const float *Ve, const float *Vn,
+                       const float *Se, const float *Sn, size_t count, float cx, float cy,
+                       double sums[TRANSFORM_SUMS])
+{
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 vcx = _mm256_set1_ps(cx);
+  const __m256 vcy = _mm256_set1_ps(cy);
+  const size_t vecCount = count & ~(size_t)7;
+
+  for (size_t block = 0; block < vecCount; block += TRANSFORM_BLOCK)
+  {
+    const size_t blockEnd = (vecCount < block + TRANSFORM_BLOCK ? vecCount : block + TRANSFORM_BLOCK);
+    __m256 acc[TRANSFORM_SUMS];
+    for (int s = 0; s < TRANSFORM_SUMS; s++)
+      acc[s] = _mm256_setzero_ps();
+
+    for (size_t n = block; n < blockEnd; n += 8)
+    {
+      const __m256 se = _mm256_loadu_ps(Se + n);
+      const __m256 sn = _mm256_loadu_ps(Sn + n);
+      const __m256 a = _mm256_div_ps(one, _mm256_mul_ps(se, se));
+      const __m256 b = _mm256_div_ps(one, _mm256_mul_ps(sn, sn));
+      const __m256 u = _mm256_sub_ps(_mm256_loadu_ps(lon + n), vcx);
+      const __m256 v = _mm256_sub_ps(_mm256_loadu_ps(lat + n), vcy);
+      const __m256 ru = _mm256_loadu_ps(Ve + n);
+      const __m256 rv = _mm256_loadu_ps(Vn + n);
+
+      const __m256 au = _mm256_mul_ps(a, u), av = _mm256_mul_ps(a, v);
+      const __m256 bu = _mm256_mul_ps(b, u), bv = _mm256_mul_ps(b, v);
+      const __m256 aru = _mm256_mul_ps(a, ru), brv = _mm256_mul_ps(b, rv);
+      acc[TS_A] = _mm256_add_ps(acc[TS_A], a);
+      acc[TS_AU] = _mm256_add_ps(acc[TS_AU], au);
+      acc[TS_AV] = _mm256_add_ps(acc[TS_AV], av);
+      acc[TS_B] = _mm256_add_ps(acc[TS_B], b);
+      acc[TS_BU] = _mm256_add_ps(acc[TS_BU], bu);
+      acc[TS_BV] = _mm256_add_ps(acc[TS_BV], bv);
+      acc[TS_AUU] = _mm256_add_ps(acc[TS_AUU], _mm256_mul_ps(au, u));
+      acc[TS_AVV] = _mm256_add_ps(acc[TS_AVV], _mm256_mul_ps(av, v));
+      acc[TS_BUU] = _mm256_add_ps(acc[TS_BUU], _mm256_mul_ps(bu, u));
+      acc[TS_BVV] = _mm256_add_ps(acc[TS_BVV], _mm256_mul_ps(bv, v));
+      acc[TS_ABUV] = _mm256_add_ps(acc[TS_ABUV], _mm256_mul_ps(_mm256_add_ps(au, bu), v));
+      acc[TS_ARU] = _mm256_add_ps(acc[TS_ARU], aru);
+      acc[TS_BRV] = _mm256_add_ps(acc[TS_BRV], brv);
+      acc[TS_S] = _mm256_add_ps(acc[TS_S], _mm256_add_ps(_mm256_mul_ps(aru, u), _mm256_mul_ps(brv, v)));
+      acc[TS_T] = _mm256_add_ps(acc[TS_T], _mm256_add_ps(_mm256_mul_ps(aru, v), _mm256_mul_ps(brv, u)));
+      acc[TS_RWR] = _mm256_add_ps(acc[TS_RWR], _mm256_add_ps(_mm256_mul_ps(aru, ru), _mm256_mul_ps(brv, rv)));
+    }
+
+    for (int s = 0; s < TRANSFORM_SUMS; s++)
+      sums[s] += hsum(acc[s]);
+  }
+
+  // Remainder through the SSE kernel (defined in the baseline unit)
+  transformSumsSSE(lon + vecCount, lat + vecCount, Ve + vecCount, Vn + vecCount,
+                   Se + vecCount, Sn + vecCount, count - vecCount, cx, cy, sums);
+}
+
+#else
+
+void transformSumsAVX2(const float *lon, const float *lat, const float *Ve, const float *Vn,
+                       const float *Se, const float *Sn, size_t count, float cx, float cy,
+                       double sums[TRANSFORM_SUMS])
+{
+  transformSumsSSE(lon, lat, Ve, Vn, Se, Sn, count, cx, cy, sums);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef _QGIS_pnwRotationPlugin_PARALLEL_FOR_H_
+#define _QGIS_pnwRotationPlugin_PARALLEL_FOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Run fn(i) for every i in [0, count) across the hardware threads.
+// Indices are handed out one at a time so uneven work items balance out.
+// Callers keep one output per index, so results never depend on scheduling.
+template <typename Fn>
+void parallelFor(int count, Fn &&fn, int threads = 0)
+{
+   if (count <= 0)
+      return;
+   if (threads <= 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+   threads = std::min(threads, count);
+
+   if (threads == 1)
+   {
+      for (int i = 0; i < count; i++)
+         fn(i);
+      return;
+   }
+
+   std::atomic<int> next{0};
+   auto worker = [&]()
+   {
+      for (int i = next++; i < count; i = next++)
+         fn(i);
+   };
+
+   std::vector<std::thread> pool;
+   pool.reserve(threads - 1);
+   for (int t = 1; t < threads; t++)
+      pool.emplace_back(worker);
+   worker();
+   for (std::thread &thread : pool)
+      thread.join();
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "pluginLog.h"
+#include "qgsmessagelog.h"
+#include <cmath>
+#include <cstdint>
+
+QString LogRecord::toString() const
+{
+   if (!format)
+      return text;
+   // Counts print as integers, everything else at full precision rather than arg's default 6 digits
+   QString message = QString::fromUtf8(format);
+   for (int i = 0; i < argCount; i++)
+   {
+      const double value = args[i];
+      if (value == std::trunc(value) && std::abs(value) < 9007199254740992.0) // 2^53
+         message = message.arg((qlonglong)value);
+      else
+         message = message.arg(value, 0, 'g', 15);
+   }
+   return message;
+}
+
+LogRing::LogRing(size_t capacity)
+{
+   size_t size = 2;
+   while (size < capacity)
+      size *= 2;
+   m_cells.reset(new Cell[size]);
+   m_mask = size - 1;
+   for (size_t i = 0; i < size; i++)
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool LogRing::push(LogRecord &&record)
+{
+   Cell *cell;
+   size_t pos = m_enqueue.load(std::memory_order_relaxed);
+   for (;;)
+   {
+      cell = &m_cells[pos & m_mask];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+      if (diff == 0)
+      {
+         if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+      }
+      else if (diff < 0)
+         return false; // full
+      else
+         pos = m_enqueue.load(std::memory_order_relaxed);
+   }
+   cell->record = std::move(record);
+   cell->sequence.store(pos + 1, std::memory_order_release);
+   return true;
+}
+
+bool LogRing::pop(LogRecord &record)
+{
+   Cell *cell;
+   size_t pos = m_dequeue.load(std::memory_order_relaxed);
+   for (;;)
+   {
+      cell = &m_cells[pos & m_mask];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+      if (diff == 0)
+      {
+         if (m_dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+      }
+      else if (diff < 0)
+         return false; // empty
+      else
+         pos = m_dequeue.load(std::memory_order_relaxed);
+   }
+   record = std::move(cell->record);
+   cell->record.text.clear();
+   cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+   return true;
+}
+
+PluginLog::PluginLog(const QString &tag, size_t capacity) : m_tag(tag), m_ring(capacity)
+{
+   connect(&m_timer, &QTimer::timeout, this, &PluginLog::flush);
+}
+
+PluginLog::~PluginLog()
+{
+   flush();
+}
+
+void PluginLog::start(int intervalMs)
+{
+   m_timer.start(intervalMs);
+}
+
+void PluginLog::log(LogLevel level, const QString &text)
+{
+   if (!enabled(level))
+      return;
+   LogRecord record;
+   record.level = level;
+   record.text = text;
+   enqueue(std::move(record));
+}
+
+void PluginLog::enqueue(LogRecord &&record)
+{
+   if (!m_ring.push(std::move(record)))
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+Qgis::MessageLevel PluginLog::messageLevel(LogLevel level)
+{
+   switch (level)
+   {
+   case LogLevel::Warning:
+      return Qgis::MessageLevel::Warning;
+   case LogLevel::Critical:
+      return Qgis::MessageLevel::Critical;
+   default:
+      return Qgis::MessageLevel::Info;
+   }
+}
+
+// Consecutive records of one level go out as a single message
+void PluginLog::flush()
+{
+   LogRecord record;
+   QString batch;
+   LogLevel batchLevel = LogLevel::Info;
+   while (m_ring.pop(record))
+   {
+      if (!batch.isEmpty() && record.level != batchLevel)
+      {
+         QgsMessageLog::logMessage(batch, m_tag, messageLevel(batchLevel));
+         batch.clear();
+      }
+      if (!batch.isEmpty())
+         batch += '\n';
+      batch += record.toString();
+      batchLevel = record.level;
+   }
+   if (!batch.isEmpty())
+      QgsMessageLog::logMessage(batch, m_tag, messageLevel(batchLevel));
+
+   const long long dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+   if (dropped)
+      QgsMessageLog::logMessage(QString::number(dropped) + " log records dropped, the log queue was full", m_tag, Qgis::MessageLevel::Warning);
+}
@@ -0,0 +1,112 @@
+#ifndef _QGIS_pnwRotationPlugin_PLUGIN_LOG_H_
+#define _QGIS_pnwRotationPlugin_PLUGIN_LOG_H_
+
+#include "qgis.h"
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+enum class LogLevel
+{
+   Debug,   // per feature / per step detail
+   Info,
+   Warning,
+   Critical
+};
+
+const int LOG_MAX_ARGS = 8;
+
+// One pending message. Numeric arguments replace %1.. in format when the
+// record is flushed, text is used as is when format is null.
+struct LogRecord
+{
+   LogLevel level = LogLevel::Info;
+   const char *format = nullptr; // string literal
+   QString text;
+   int argCount = 0;
+   double args[LOG_MAX_ARGS];
+
+   QString toString() const;
+};
+
+// Bounded lock-free multi producer / multi consumer queue of log records
+// (sequence numbered cells), push fails rather than blocks when full.
+class LogRing
+{
+public:
+   explicit LogRing(size_t capacity); // rounded up to a power of 2
+
+   bool push(LogRecord &&record);
+   bool pop(LogRecord &record);
+
+private:
+   struct Cell
+   {
+      std::atomic<size_t> sequence;
+      LogRecord record;
+   };
+
+   std::unique_ptr<Cell[]> m_cells;
+   size_t m_mask;
+   alignas(64) std::atomic<size_t> m_enqueue{0};
+   alignas(64) std::atomic<size_t> m_dequeue{0};
+};
+
+// Leveled plugin log in front of the QGIS message log.
+// Records below the level are dropped with one atomic load, the rest are
+// queued from any thread and formatted on the GUI thread, where the timer
+// posts each batch as one message per level run.
+class PluginLog : public QObject
+{
+   Q_OBJECT
+
+public:
+   explicit PluginLog(const QString &tag, size_t capacity = 8192);
+   ~PluginLog();
+
+   void setLevel(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+   LogLevel level() const { return m_level.load(std::memory_order_relaxed); }
+   bool enabled(LogLevel level) const { return level >= this->level(); }
+
+   /// @brief Flush every intervalMs on the calling (GUI) thread
+   void start(int intervalMs);
+
+   /// @brief format is a string literal with %1.. for the numeric args
+   template <typename... Args>
+   void log(LogLevel level, const char *format, Args... args)
+   {
+      static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+      if (!enabled(level))
+         return;
+      LogRecord record;
+      record.level = level;
+      record.format = format;
+      record.argCount = 0;
+      ((record.args[record.argCount++] = (double)args), ...);
+      enqueue(std::move(record));
+   }
+   void log(LogLevel level, const QString &text);
+
+   template <typename... Args>
+   void debug(const char *format, Args... args) { log(LogLevel::Debug, format, args...); }
+   void info(const QString &text) { log(LogLevel::Info, text); }
+   void warning(const QString &text) { log(LogLevel::Warning, text); }
+
+public slots:
+   void flush();
+
+private:
+   void enqueue(LogRecord &&record);
+   static Qgis::MessageLevel messageLevel(LogLevel level);
+
+   QString m_tag;
+   LogRing m_ring;
+   QTimer m_timer;
+   std::atomic<LogLevel> m_level{LogLevel::Info};
+   std::atomic<long long> m_dropped{0}; // records lost to a full ring since the last flush
+};
+
+#endif
@@ -5,6 +5,8 @@
 #include <qgslinesymbol.h>
 #include <QtWidgets>
 #include <qaction.h>
+#include "qgsapplication.h"
+#include "qgsrasterlayer.h"
 #include <cstdio>
 
 namespace
@@ -18,6 +20,9 @@ namespace
    const QgisPlugin::PluginType s_type = QgisPlugin::UI;
    const QString s_yhsDestLayerName = "YHS movement";
    const QString s_rotDestLayerName = "PNW rotation";
+   const QString s_ensembleDensityLayerName = "YHS track density";
+   const QString s_ensembleEnvelopeLayerName = "YHS track envelope";
+   const QString s_rotationModelFile = "pnw_rotation_py/GPlates/Muller_etal_2019_CombinedRotations.rot"; // relative to the project
 }
 
 QGISEXTERN QgisPlugin *classFactory(QgisInterface *qgis_if)
@@ -62,7 +67,7 @@ QGISEXTERN void unload(QgisPlugin *plugin)
    delete plugin;
 }
 
-pnwRotationPlugin::pnwRotationPlugin(QgisInterface *iface) : QgisPlugin(s_name, s_description, s_category, s_version, s_type), m_qgis_if(iface)
+pnwRotationPlugin::pnwRotationPlugin(QgisInterface *iface) : QgisPlugin(s_name, s_description, s_category, s_version, s_type), m_qgis_if(iface), m_log(s_name)
 {
    m_qgis_if = iface;
 
@@ -73,10 +78,18 @@ pnwRotationPlugin::pnwRotationPlugin(QgisInterface *iface) : QgisPlugin(s_name,
    m_pYhsState.push_back(yhsState0);
 
    m_passes = 0;
+
+   // step batches are queued across threads from background runs
+   qRegisterMetaType<QVector<YhsTrackStep>>("QVector<YhsTrackStep>");
 }
 
 void pnwRotationPlugin::unload()
 {
+   cancelYhsRuns();
+   if (m_ensembleTask)
+      m_ensembleTask->cancel();
+   m_log.flush();
+
    // TODO - need to remove the actions from the menu again.
    // Get the QgsProject instance
    QgsProject *project = QgsProject::instance();
@@ -106,11 +119,12 @@ void pnwRotationPlugin::unload()
 
 void pnwRotationPlugin::initGui()
 {
-   QgsMessageLog::logMessage(QString("initGui"), name(), Qgis::MessageLevel::Info);
+   m_log.start(logFlushIntervalMs);
+   m_log.info(QString("initGui"));
 
    if (m_qgis_if == nullptr)
    {
-      QgsMessageLog::logMessage("failed to get the handle to QGIS", name(), Qgis::MessageLevel::Info);
+      m_log.info("failed to get the handle to QGIS");
       return;
    }
 
@@ -128,6 +142,29 @@ void pnwRotationPlugin::initGui()
    m_yhs_menu_action = new QAction(QIcon(""), QString("Move YHS"), this);
    connect(m_yhs_menu_action, SIGNAL(triggered()), this, SLOT(yhs_menu_button_action()));
    m_qgis_if->addPluginToMenu(QString("&PnwRotationPlugin"), m_yhs_menu_action);
+
+   // add YHS ensemble action to the menu
+   m_yhs_ensemble_menu_action = new QAction(QIcon(""), QString("YHS Ensemble"), this);
+   connect(m_yhs_ensemble_menu_action, SIGNAL(triggered()), this, SLOT(yhs_ensemble_menu_button_action()));
+   m_qgis_if->addPluginToMenu(QString("&PnwRotationPlugin"), m_yhs_ensemble_menu_action);
+
+   // add profiling toggle and summary actions to the menu
+   m_profile_menu_action = new QAction(QIcon(""), QString("Profiling"), this);
+   m_profile_menu_action->setCheckable(true);
+   m_profile_menu_action->setChecked(Profiler::instance().enabled());
+   connect(m_profile_menu_action, SIGNAL(toggled(bool)), this, SLOT(profile_menu_button_action(bool)));
+   m_qgis_if->addPluginToMenu(QString("&PnwRotationPlugin"), m_profile_menu_action);
+
+   m_profile_summary_menu_action = new QAction(QIcon(""), QString("Profile summary"), this);
+   connect(m_profile_summary_menu_action, SIGNAL(triggered()), this, SLOT(profile_summary_menu_button_action()));
+   m_qgis_if->addPluginToMenu(QString("&PnwRotationPlugin"), m_profile_summary_menu_action);
+
+   // per station and per step detail goes to the message log only when checked
+   m_verbose_menu_action = new QAction(QIcon(""), QString("Verbose log"), this);
+   m_verbose_menu_action->setCheckable(true);
+   m_verbose_menu_action->setChecked(m_log.enabled(LogLevel::Debug));
+   connect(m_verbose_menu_action, SIGNAL(toggled(bool)), this, SLOT(verbose_menu_button_action(bool)));
+   m_qgis_if->addPluginToMenu(QString("&PnwRotationPlugin"), m_verbose_menu_action);
 }
 
 bool pnwRotationPlugin::setupLayers()
@@ -137,28 +174,30 @@ bool pnwRotationPlugin::setupLayers()
 
    if (!loadRotData())
    {
-      QgsMessageLog::logMessage("failed to load rot data from layer", name(), Qgis::MessageLevel::Info);
+      m_log.info("failed to load rot data from layer");
       return false;
    }
+   if (!loadRotationModel())
+      m_log.info("No rotation model, using the NA speed and bearing constants");
    if (!setupRotLayer())
    {
-      QgsMessageLog::logMessage("failed to setup layer", name(), Qgis::MessageLevel::Info);
+      m_log.info("failed to setup layer");
       return false;
    }
    if (!setupYhsLayer())
    {
-      QgsMessageLog::logMessage("failed to setup layer", name(), Qgis::MessageLevel::Info);
+      m_log.info("failed to setup layer");
       return false;
    }
    m_layers_setup = true;
-   QgsMessageLog::logMessage("Layers set up ", name(), Qgis::MessageLevel::Info);
+   m_log.info("Layers set up ");
 
    return true;
 }
 
 bool pnwRotationPlugin::setupRotLayer() // Rot layer must be loaded in qgis first (so not at qgis launch)
 {
-   QgsMessageLog::logMessage(QString("Setup dest layer "), name(), Qgis::MessageLevel::Info);
+   m_log.info(QString("Setup dest layer "));
 
    QString providerName = "memory";     // Or "ogr" for file-based data
    QString uri = "Point?crs=epsg:4326"; // Example URI for memory provider
@@ -191,6 +230,10 @@ bool pnwRotationPlugin::setupRotLayer() // Rot layer must be loaded in qgis firs
 
 void pnwRotationPlugin::displayRotData(QgsFeatureList &featureList)
 {
+   ProfileScope scope("displayRotData");
+   Profiler::count(ProfileCounter::FeaturesAdded, featureList.size());
+   Profiler::count(ProfileCounter::Repaints);
+
    // copy feature data over
    m_rotDestLayer->dataProvider()->addFeatures(featureList);
 
@@ -201,7 +244,7 @@ void pnwRotationPlugin::displayRotData(QgsFeatureList &featureList)
 
 bool pnwRotationPlugin::setupYhsLayer() // Rot layer must be loaded in qgis first (so not at qgis launch)
 {
-   QgsMessageLog::logMessage(QString("Setup YHS layer "), name(), Qgis::MessageLevel::Info);
+   m_log.info(QString("Setup YHS layer "));
 
    QString providerName = "memory";     // Or "ogr" for file-based data
    QString uri = "LineString?crs=epsg:4326"; // Example URI for memory provider
@@ -219,8 +262,6 @@ bool pnwRotationPlugin::setupYhsLayer() // Rot layer must be loaded in qgis firs
    lineSymbol->setWidth(0.5);
    lineSymbol->setColor(QColor (255, 0, 0)); // Set color to blue
 
-   m_line << QgsPointXY(YHS_lon, YHS_lat); // Set initial point to current YHS
-
    return true;
 }
 
@@ -229,80 +270,311 @@ void pnwRotationPlugin::yhs_menu_button_action()
    if (!setupLayers())
       return;
 
-   pState p_last = m_pYhsState.at(m_line.length() - 1);
-   while (p_last.lon > longitudeLimit)
+   // Each run integrates on a QgsTask from the current YHS and draws its own track
+   const int runId = m_nextRunId++;
+   const pState start = m_pYhsState.front();
+   YhsRun &run = m_yhsRuns[runId];
+   run.line << QgsPointXY(start.lon, start.lat);
+
+   YhsTrackTask *task = new YhsTrackTask(runId, m_rotField, start, detlaT, longitudeLimit, repaintIntervalMs,
+                                         trackIntegrator, trackToleranceKm);
+   run.task = task;
+   connect(task, &YhsTrackTask::stepsReady, this, &pnwRotationPlugin::yhs_steps_ready);
+   connect(task, &QgsTask::taskCompleted, this, [this, runId, task]()
+           { yhsRunFinished(runId, true, task->steps(), task->fieldEvaluations()); });
+   connect(task, &QgsTask::taskTerminated, this, [this, runId, task]()
+           { yhsRunFinished(runId, false, task->steps(), task->fieldEvaluations()); });
+
+   m_log.debug("NA Move \tE: %1 deg,\tN: %2 deg\t(E: %3 km\tN: %4 km)",
+               YHS_lon, YHS_lat, m_NA_Vel_E * detlaT / 1E6, m_NA_Vel_N * detlaT / 1E6);
+
+   QgsApplication::taskManager()->addTask(task);
+}
+
+// A batch of steps from a background run, on the GUI thread
+void pnwRotationPlugin::yhs_steps_ready(int runId, QVector<YhsTrackStep> steps)
+{
+   ProfileScope scope("yhs_steps_ready");
+   auto it = m_yhsRuns.find(runId);
+   if (it == m_yhsRuns.end()) // cleared while the run was in flight
+      return;
+   YhsRun &run = it.value();
+
+   for (const YhsTrackStep &step : steps)
    {
-      // Get closest rotation vector velocity from rotation field
-      QgsFeature rotFeature = getClosestRotEntry(p_last.lon, p_last.lat);
-      double rotVe = getFeatureAttrubute(rotFeature, 2);
-      double rotVn = getFeatureAttrubute(rotFeature, 3);
+      ////////////////// Update polyline layer line
+      run.line << QgsPointXY(step.state.lon, step.state.lat);
+
+      QgsFeature rotFeature = m_rotFeatureList.at(step.station);
+      if (m_log.enabled(LogLevel::Debug))
+      {
+         // rotVe / rotVn in mm/yr
+         m_log.debug("Rot Move \tE: %1 deg,\tN: %2 deg\t(E: %3 km\tN: %4 km)",
+                     step.deltaLon, step.deltaLat, step.rotVe * detlaT / 1E6, step.rotVn * detlaT / 1E6);
+         m_log.debug("YHS Rot: %1\t%2\t%3\t%4\t", getFeatureAttrubute(rotFeature, 0), getFeatureAttrubute(rotFeature, 1),
+                     m_rotField->ve[step.station], m_rotField->vn[step.station]);
+      }
+
+      ///////////////////// Update Rot layer vector
+      m_rotFeatureList2.push_back(rotFeature);
+      m_passes++;
+   }
 
-      // Get state change
-       double deltaLon = longitudeFromDistance(p_last.lat, p_last.ve * detlaT);
-      double deltaLat = latitudeFromDisatnce(p_last.vn * detlaT);
-      double deltaVe = rotVe; // mm/yr
-      double deltaVn = rotVn; // mm/yr
+   appendRotData();
+   displayYhsData(run);
+}
 
-      pState p_next = {
-          p_last.lon + deltaLon,
-          p_last.lat + deltaLat,
-         p_last.ve + deltaVe,
-          p_last.vn + deltaVn};
+void pnwRotationPlugin::yhsRunFinished(int runId, bool completed, int steps, long long evaluations)
+{
+   auto it = m_yhsRuns.find(runId);
+   if (it != m_yhsRuns.end())
+      it.value().task = nullptr;
 
-      m_pYhsState.push_back(p_next);
+   QString status = completed ? QString("Completed") : QString("Cancelled");
+   m_log.info(status + " run " + QString::number(runId) + ". Passes = " + QString::number(m_passes) +
+              ", steps = " + QString::number(steps) + ", field evaluations = " + QString::number(evaluations));
+}
 
-      ////////////////// Update polyline layer line
-      QgsPointXY nextPoint(p_next.lon, p_next.lat);
-      m_line << nextPoint;
+// Monte-Carlo tracks with perturbed plate motion and station velocities,
+// shown as a density raster and percentile envelopes
+void pnwRotationPlugin::yhs_ensemble_menu_button_action()
+{
+   if (!setupLayers())
+      return;
+   if (m_ensembleTask)
+   {
+      m_log.info("Ensemble already running");
+      return;
+   }
+
+   const pState start = m_pYhsState.front();
+   EnsembleParams params;
+   params.members = ensembleMembers;
+   params.seed = ++m_ensembleRuns;
+   params.startLon = start.lon;
+   params.startLat = start.lat;
+   params.speed = std::hypot(m_NA_Vel_E, m_NA_Vel_N);
+   params.speedSigma = NA_SpeedSigma;
+   params.bearing = std::atan2(m_NA_Vel_E, m_NA_Vel_N) * 180.0 / M_PI;
+   params.bearingSigma = NA_BearingSigma;
+   params.method = trackIntegrator;
+   params.deltaT = detlaT;
+   params.toleranceKm = trackToleranceKm;
+   params.longitudeLimit = longitudeLimit;
+   params.cellDeg = ensembleCellDeg;
+
+   YhsEnsembleTask *task = new YhsEnsembleTask(m_rotField, params);
+   m_ensembleTask = task;
+   connect(task, &QgsTask::taskCompleted, this, [this, task]() { displayEnsemble(task->params(), task->result()); });
+   connect(task, &QgsTask::taskTerminated, this, [this]()
+           { m_log.info("Ensemble cancelled"); });
+   QgsApplication::taskManager()->addTask(task);
+}
+
+void pnwRotationPlugin::displayEnsemble(const EnsembleParams &params, const EnsembleResult &result)
+{
+   m_log.info(QString("Ensemble of ") + QString::number(result.members) + " tracks, field evaluations = " +
+              QString::number(result.evaluations));
+
+   removeLayers(s_ensembleDensityLayerName);
+   removeLayers(s_ensembleEnvelopeLayerName);
+
+   // Density goes out as an ESRI ASCII grid for the gdal provider
+   const QString densityFile = QDir(QDir::tempPath()).filePath(QString("pnwRotation_yhsDensity_%1.asc").arg(m_ensembleRuns));
+   if (writeDensityRaster(result, densityFile))
+   {
+      QgsRasterLayer *densityLayer = new QgsRasterLayer(densityFile, s_ensembleDensityLayerName, "gdal");
+      if (densityLayer->isValid())
+         QgsProject::instance()->addMapLayer(densityLayer);
+      else
+         delete densityLayer;
+   }
+   else
+      m_log.warning(QString("Could not write ") + densityFile);
+
+   // One envelope line per percentile, from the start through the sample longitudes
+   QgsVectorLayer *envelopeLayer = new QgsVectorLayer("LineString?crs=EPSG:4326&field=percentile:double", s_ensembleEnvelopeLayerName, "memory");
+   if (!envelopeLayer->isValid())
+   {
+      delete envelopeLayer;
+      return;
+   }
 
-      if (m_verbose)
+   QgsFeatureList features;
+   for (size_t k = 0; k < params.percentiles.size(); k++)
+   {
+      QgsPolylineXY line;
+      line << QgsPointXY(params.startLon, params.startLat);
+      for (size_t s = 0; s < result.sampleLon.size(); s++)
       {
-         if (m_line.length() == 2)
-         {
-            QString entryDataString("NA Move \t");
-            entryDataString += "E: " + QString::number(YHS_lon) + " deg,\t";
-            entryDataString += "N: " + QString::number(YHS_lat) + " deg\t";
-            entryDataString += "(E: " + QString::number(m_NA_Vel_E * detlaT / 1E6) + " km\t";
-            entryDataString += "N: " + QString::number(m_NA_Vel_N * detlaT / 1E6) + " km)";
-            QgsMessageLog::logMessage(entryDataString, name(), Qgis::MessageLevel::Info);
-         }
-         QString entryDataString("Rot Move \t");
-         entryDataString += "E: " + QString::number(deltaLon) + " deg,\t";
-         entryDataString += "N: " + QString::number(deltaLat) + " deg\t";
-         entryDataString += "(E: " + QString::number(deltaVe * detlaT / 1E6) + " km\t";
-         entryDataString += "N: " + QString::number(deltaVn * detlaT / 1E6) + " km)";
-         QgsMessageLog::logMessage(entryDataString, name(), Qgis::MessageLevel::Info);
+         if (!std::isnan(result.envelopeLat[k][s]))
+            line << QgsPointXY(result.sampleLon[s], result.envelopeLat[k][s]);
       }
 
-      displayYhsData(m_line);
+      QgsFeature feature(envelopeLayer->fields());
+      feature.setGeometry(QgsGeometry::fromPolylineXY(line));
+      feature.setAttribute(0, params.percentiles[k]);
+      features << feature;
+   }
+   envelopeLayer->dataProvider()->addFeatures(features);
+   envelopeLayer->updateExtents();
+   QgsProject::instance()->addMapLayer(envelopeLayer);
+}
 
-      ///////////////////// Update Rot layer vector
-      if (m_verbose)
-         printFeature(rotFeature, QString("YHS Rot: "));
+bool pnwRotationPlugin::writeDensityRaster(const EnsembleResult &result, const QString &fileName)
+{
+   QFile file(fileName);
+   if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+      return false;
 
-      m_rotFeatureList2.push_back(rotFeature);
-      displayRotData(m_rotFeatureList2);
+   QTextStream out(&file);
+   out << "ncols " << result.cols << "\n";
+   out << "nrows " << result.rows << "\n";
+   out << "xllcorner " << QString::number(result.lonMin, 'f', 6) << "\n";
+   out << "yllcorner " << QString::number(result.latMax - result.rows * result.cellDeg, 'f', 6) << "\n";
+   out << "cellsize " << QString::number(result.cellDeg, 'f', 6) << "\n";
+   out << "NODATA_value -9999\n";
+   for (int r = 0; r < result.rows; r++)
+   {
+      QString row;
+      for (int c = 0; c < result.cols; c++)
+      {
+         if (c)
+            row += ' ';
+         row += QString::number(result.density[(size_t)r * result.cols + c], 'g', 6);
+      }
+      out << row << "\n";
+   }
+   out.flush();
+   return out.status() == QTextStream::Ok;
+}
 
-      p_last = p_next;
-      m_passes++;
+void pnwRotationPlugin::removeLayers(const QString &layerName)
+{
+   QgsProject *project = QgsProject::instance();
+   for (QgsMapLayer *layer : project->mapLayersByName(layerName))
+      project->removeMapLayer(layer->id());
+}
+
+void pnwRotationPlugin::verbose_menu_button_action(bool verbose)
+{
+   m_log.setLevel(verbose ? LogLevel::Debug : LogLevel::Info);
+}
+
+void pnwRotationPlugin::profile_menu_button_action(bool enabled)
+{
+   Profiler::instance().setEnabled(enabled);
+   m_log.info(QString("Profiling ") + (enabled ? "on" : "off"));
+}
+
+// Scope timings and counters since the last reset, with trace export
+void pnwRotationPlugin::profile_summary_menu_button_action()
+{
+   QDialog dialog(m_qgis_if->mainWindow());
+   dialog.setWindowTitle("PNW rotation profile");
+   dialog.resize(720, 420);
+
+   QPlainTextEdit *text = new QPlainTextEdit(&dialog);
+   text->setReadOnly(true);
+   text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+   auto refresh = [text]()
+   {
+      QString header = Profiler::instance().enabled() ? QString() : QString("Profiling is off, enable it from the plugin menu\n\n");
+      text->setPlainText(header + QString::fromStdString(Profiler::instance().summary()));
+   };
+   refresh();
+
+   QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close, &dialog);
+   QPushButton *refreshButton = buttons->addButton("Refresh", QDialogButtonBox::ActionRole);
+   QPushButton *resetButton = buttons->addButton("Reset", QDialogButtonBox::ResetRole);
+   QPushButton *exportButton = buttons->addButton("Export trace...", QDialogButtonBox::ActionRole);
+   connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+   connect(refreshButton, &QPushButton::clicked, &dialog, refresh);
+   connect(resetButton, &QPushButton::clicked, &dialog, [refresh]()
+           {
+              Profiler::instance().reset();
+              refresh();
+           });
+   connect(exportButton, &QPushButton::clicked, &dialog, [this, &dialog]()
+           {
+              const QString fileName = QFileDialog::getSaveFileName(&dialog, "Export Chrome trace", QDir::homePath() + "/pnwRotationTrace.json", "Trace (*.json)");
+              if (fileName.isEmpty())
+                 return;
+              if (Profiler::instance().writeChromeTrace(fileName.toStdString()))
+                 m_log.info(QString("Wrote profile trace ") + fileName);
+              else
+                 m_log.warning(QString("Could not write ") + fileName);
+           });
+
+   QVBoxLayout *layout = new QVBoxLayout(&dialog);
+   layout->addWidget(text);
+   layout->addWidget(buttons);
+   dialog.exec();
+}
+
+void pnwRotationPlugin::cancelYhsRuns()
+{
+   for (YhsRun &run : m_yhsRuns)
+   {
+      if (run.task)
+         run.task->cancel();
+   }
+}
+
+// Add only the rot features not yet in the layer
+void pnwRotationPlugin::appendRotData()
+{
+   ProfileScope scope("appendRotData");
+   Profiler::count(ProfileCounter::Repaints);
+   if (m_rotFeaturesShown < m_rotFeatureList2.size())
+   {
+      QgsFeatureList newFeatures = m_rotFeatureList2.mid(m_rotFeaturesShown);
+      Profiler::count(ProfileCounter::FeaturesAdded, newFeatures.size());
+      m_rotDestLayer->dataProvider()->addFeatures(newFeatures);
+      m_rotFeaturesShown = m_rotFeatureList2.size();
+      m_rotDestLayer->updateExtents();
    }
-   QgsMessageLog::logMessage(QString("Completed. Passes = ") + QString::number(m_passes), name(), Qgis::MessageLevel::Info);
+
+   showLayer(m_rotDestLayer);
+   m_rotDestLayer->triggerRepaint();
 }
 
-void pnwRotationPlugin::displayYhsData(QgsPolylineXY &line)
+void pnwRotationPlugin::displayYhsData(YhsRun &run)
 {
-   QgsFeature feature(m_yhsDestLayer->fields());
-   feature.setGeometry(QgsGeometry::fromPolylineXY(line));
+   ProfileScope scope("displayYhsData");
+   Profiler::count(ProfileCounter::Repaints);
+   QgsGeometry geometry = QgsGeometry::fromPolylineXY(run.line);
+   QgsVectorDataProvider *provider = m_yhsDestLayer->dataProvider();
 
-   // Add feature to the layer
-   m_yhsDestLayer->startEditing();
-   m_yhsDestLayer->addFeature(feature);
-   m_yhsDestLayer->commitChanges();
-   QgsProject::instance()->addMapLayer(m_yhsDestLayer);
+   // One track feature per run, its geometry is replaced rather than re-added
+   if (run.fid == FID_NULL)
+   {
+      Profiler::count(ProfileCounter::FeaturesAdded);
+      QgsFeature feature(m_yhsDestLayer->fields());
+      feature.setGeometry(geometry);
+      QgsFeatureList features;
+      features << feature;
+      if (provider->addFeatures(features))
+         run.fid = features.first().id();
+   }
+   else
+   {
+      QgsGeometryMap geometries;
+      geometries.insert(run.fid, geometry);
+      provider->changeGeometryValues(geometries);
+   }
+   m_yhsDestLayer->updateExtents();
 
+   showLayer(m_yhsDestLayer);
    m_yhsDestLayer->triggerRepaint();
 }
 
+void pnwRotationPlugin::showLayer(QgsVectorLayer *layer)
+{
+   if (!QgsProject::instance()->mapLayer(layer->id()))
+      QgsProject::instance()->addMapLayer(layer);
+}
+
 void pnwRotationPlugin::rot_menu_button_action()
 {
    if (!setupLayers())
@@ -315,8 +587,13 @@ void pnwRotationPlugin::rot_menu_button_action()
 
 void pnwRotationPlugin::clear_menu_button_action()
 {
-   QgsMessageLog::logMessage(QString("Clearing yhs data"), name(), Qgis::MessageLevel::Info);
+   m_log.info(QString("Clearing yhs data"));
    clear_display_data();
+
+   if (m_ensembleTask)
+      m_ensembleTask->cancel();
+   removeLayers(s_ensembleDensityLayerName);
+   removeLayers(s_ensembleEnvelopeLayerName);
 }
 
 void pnwRotationPlugin::clear_display_data()
@@ -324,7 +601,7 @@ void pnwRotationPlugin::clear_display_data()
    // Clear rotDestLayer
    if (!m_rotDestLayer)
    {
-      QgsMessageLog::logMessage("Error: Provided m_rotDestLayer is null.", name(), Qgis::MessageLevel::Info);
+      m_log.info("Error: Provided m_rotDestLayer is null.");
       return;
    }
 
@@ -333,41 +610,44 @@ void pnwRotationPlugin::clear_display_data()
 
    if (!dataProvider)
    {
-      QgsMessageLog::logMessage("Error: Data provider not found for the m_rotDestLayer.", name(), Qgis::MessageLevel::Info);
+      m_log.info("Error: Data provider not found for the m_rotDestLayer.");
       return;
    }
 
    if (!dataProvider->truncate())
    {
-      QgsMessageLog::logMessage(QString("Failed to truncate m_rotDestLayer '%1'.").arg(m_rotDestLayer->name()), name(), Qgis::MessageLevel::Info);
+      m_log.info(QString("Failed to truncate m_rotDestLayer '%1'.").arg(m_rotDestLayer->name()));
       return;
    }
 
    m_rotDestLayer->commitChanges();
    m_rotDestLayer->triggerRepaint();
+   m_rotFeatureList2.clear();
+   m_rotFeaturesShown = 0;
 
    // Clear yhsDestLayer
    if (!m_yhsDestLayer)
    {
-      QgsMessageLog::logMessage("Error: Provided m_yhsDestLayer is null.", name(), Qgis::MessageLevel::Info);
+      m_log.info("Error: Provided m_yhsDestLayer is null.");
       return;
    }
 
-   m_line.clear();
-   m_line << QgsPointXY(YHS_lon, YHS_lat); // Current YHS hotspot
+   // Drop all tracks, runs still in flight are cancelled and their late batches ignored
+   cancelYhsRuns();
+   m_yhsRuns.clear();
 
    m_yhsDestLayer->startEditing();
    QgsVectorDataProvider *yhsDataProvider = m_yhsDestLayer->dataProvider();
 
    if (!yhsDataProvider)
    {
-      QgsMessageLog::logMessage("Error: Data provider not found for the m_yhsDestLayer.", name(), Qgis::MessageLevel::Info);
+      m_log.info("Error: Data provider not found for the m_yhsDestLayer.");
       return;
    }
 
    if (!yhsDataProvider->truncate())
    {
-      QgsMessageLog::logMessage(QString("Failed to truncate m_yhsDestLayer '%1'.").arg(m_yhsDestLayer->name()), name(), Qgis::MessageLevel::Info);
+      m_log.info(QString("Failed to truncate m_yhsDestLayer '%1'.").arg(m_yhsDestLayer->name()));
       return;
    }
 
@@ -380,7 +660,8 @@ bool pnwRotationPlugin::loadRotData()
    if (m_rotDataLoaded)
       return true;
 
-   QgsMessageLog::logMessage(QString("loadRotData"), name(), Qgis::MessageLevel::Info);
+   ProfileScope scope("loadRotData");
+   m_log.info(QString("loadRotData"));
 
    // get rotation data layer
    QgsMapLayer *mapLayer = QgsProject::instance()->mapLayersByName(s_rotDatadestLayerName).value(0);
@@ -388,7 +669,7 @@ bool pnwRotationPlugin::loadRotData()
    if (!m_rotSrcLayer)
    {
       QString loadErrorMsg = QString("Could not load source layer ") + s_rotDatadestLayerName;
-      QgsMessageLog::logMessage(loadErrorMsg, name(), Qgis::MessageLevel::Info);
+      m_log.info(loadErrorMsg);
       return false;
    }
 
@@ -400,18 +681,94 @@ bool pnwRotationPlugin::loadRotData()
    // gety rot features
    QgsFeatureIterator featureIt = m_rotSrcLayer->getFeatures();
    QgsFeature feature;
+   std::shared_ptr<RotFieldSnapshot> field = std::make_shared<RotFieldSnapshot>();
+   std::vector<double> lons, lats;
    while (featureIt.nextFeature(feature))
    {
+      Profiler::count(ProfileCounter::FeaturesScanned);
       m_rotFeatureList << feature;
-
-      if (m_verbose)
-         printFeature(feature, QString("Loaded "), fields.size());
+      lons.push_back(getFeatureAttrubute(feature, 0));
+      lats.push_back(getFeatureAttrubute(feature, 1));
+      field->ve.push_back(getFeatureAttrubute(feature, 2));
+      field->vn.push_back(getFeatureAttrubute(feature, 3));
+      field->se.push_back(getFeatureAttrubute(feature, 4));
+      field->sn.push_back(getFeatureAttrubute(feature, 5));
+
+      // formatted on flush, and only when debug output is on
+      m_log.debug("Loaded %1\t%2\t%3\t%4\t%5\t%6\t", lons.back(), lats.back(), field->ve.back(), field->vn.back(),
+                  field->se.back(), field->sn.back());
    }
 
+   // index station locations once so per-step lookups never rescan the layer,
+   // background runs share this snapshot instead of reading the layer
+   field->index.build(lons, lats);
+   m_log.info(QString("Indexed ") + QString::number(field->index.size()) + " rot entries");
+
+   loadVelocityGrid(*field, lons, lats);
+   m_rotField = field;
+
    m_rotDataLoaded = true;
    return true;
 }
 
+// Interpolate the station velocities onto a grid, reusing the on-disk copy
+// while the rot layer and grid settings are unchanged
+void pnwRotationPlugin::loadVelocityGrid(RotFieldSnapshot &field, const std::vector<double> &lons, const std::vector<double> &lats)
+{
+   if (m_velocityGridParams.step <= 0)
+      return;
+   ProfileScope scope("loadVelocityGrid");
+   field.gridParams = m_velocityGridParams;
+
+   const uint64_t key = VelocityGrid::cacheKey(m_rotSrcLayer->source().toStdString(), lons, lats, field.ve, field.vn, m_velocityGridParams);
+   QDir cacheDir(QgsApplication::qgisSettingsDirPath());
+   cacheDir.mkpath("pnwRotation");
+   const QString cacheFile = cacheDir.filePath(QString("pnwRotation/velocityGrid_%1.vgrid").arg(key, 16, 16, QChar('0')));
+
+   QString status;
+   if (field.grid.load(cacheFile.toStdString(), key))
+      status = "Loaded velocity grid ";
+   else if (field.grid.build(field.index, field.ve, field.vn, m_velocityGridParams))
+   {
+      status = "Built velocity grid ";
+      if (!field.grid.save(cacheFile.toStdString(), key))
+         m_log.warning(QString("Could not write velocity grid cache ") + cacheFile);
+   }
+   else
+   {
+      m_log.warning("Velocity grid unavailable, stepping on nearest stations");
+      return;
+   }
+
+   status += QString::number(field.grid.cols()) + " x " + QString::number(field.grid.rows());
+   m_log.info(status);
+}
+
+// NA motion over the hotspot frame from the GPlates model at the YHS today
+bool pnwRotationPlugin::loadRotationModel()
+{
+   if (m_rotationModelLoaded)
+      return true;
+
+   const QString fileName = QDir(QgsProject::instance()->homePath()).filePath(s_rotationModelFile);
+   if (!m_rotationModel.load(fileName.toStdString()))
+   {
+      m_log.info(QString("Could not load rotation model ") + fileName + " " + QString::fromStdString(m_rotationModel.error()));
+      return false;
+   }
+
+   m_rotationModel.plateVelocity(NA_PlateId, mantlePlateId, 0.0, YHS_lon, YHS_lat, m_NA_Vel_E, m_NA_Vel_N);
+   m_pYhsState.front().ve = m_NA_Vel_E;
+   m_pYhsState.front().vn = m_NA_Vel_N;
+   m_rotationModelLoaded = true;
+
+   m_log.info(QString("Rotation model ") + QString::number(m_rotationModel.sequenceCount()) + " sequences, " +
+              QString::number(m_rotationModel.plateCount()) + " plates. NA speed " +
+              QString::number(std::hypot(m_NA_Vel_E, m_NA_Vel_N)) + " mm/yr, bearing " +
+              QString::number(std::atan2(m_NA_Vel_E, m_NA_Vel_N) * 180.0 / M_PI));
+   return true;
+}
+
 bool pnwRotationPlugin::setFeatureAttribute(QgsFeature &feature, int index, double value)
 {
    QVariant variant;
@@ -438,57 +795,36 @@ double pnwRotationPlugin::getFeatureAttrubute(QgsFeature &feature, int index)
 
 double pnwRotationPlugin::latitudeFromDisatnce(double distanceN)
 {
-   double latitude = atan(distanceN / (EARTH_RADIUS * 1000)) * 180.0 / M_PI;
-   return latitude;
+   return TrackKinematics::latitudeFromDistance(distanceN);
 }
 
 // Function to calculate new longitude after moving eastward
 // distance is in mm
 double pnwRotationPlugin::longitudeFromDistance(double latitude, double distance)
 {
-
-   double latitudeRadians = latitude * M_PI / 180.0;
-
-   // Calculate the radius of the parallel of latitude at the starting latitude
-   double radiusOfParallel = EARTH_RADIUS * std::cos(latitudeRadians);
-
-   // Calculate the change in longitude in radians
-   double deltaLongitudeRadians = distance / (radiusOfParallel * 1000);
-
-   return deltaLongitudeRadians * 180.0 / M_PI;
+   return TrackKinematics::longitudeFromDistance(latitude, distance);
 }
 
 QgsFeature pnwRotationPlugin::getClosestRotEntry(double lon, double lat)
 {
-   // get rot features
-   QgsFeatureIterator featureIt = m_rotSrcLayer->getFeatures();
-   QgsFeature feature;
-   QgsFeature closestFeature;
-
-   double Ve = 0, Vn = 0;
-   double p_lon, p_lat;
-   double minDist = 1e10;
-   while (featureIt.nextFeature(feature))
-   {
-      double f_lon = getFeatureAttrubute(feature, 0);
-      double f_lat = getFeatureAttrubute(feature, 1);
-      double dist = (sqr(f_lon - lon) + sqr(f_lat - lat));
-      if (dist < minDist)
-      {
-         minDist = dist;
-         closestFeature = feature;
-      }
-   }
-   return closestFeature;
+   ProfileScope scope("getClosestRotEntry");
+   Profiler::count(ProfileCounter::NearestLookups);
+   int idx = m_rotField ? m_rotField->index.nearest(lon, lat) : -1;
+   if (idx < 0)
+      return QgsFeature();
+   return m_rotFeatureList.at(idx);
 }
 
-void pnwRotationPlugin::printFeature(QgsFeature feature, QString label, int fields)
+QgsFeatureList pnwRotationPlugin::getClosestRotEntries(double lon, double lat, int count)
 {
-   QString entryDataString = label;
-   for (int i = 0; i < fields; ++i)
-   {
-      QVariant attributeValueByIndex = feature.attribute(i);
-      entryDataString += attributeValueByIndex.toString() + "\t";
-   }
-   QgsMessageLog::logMessage(entryDataString, name(), Qgis::MessageLevel::Info);
+   ProfileScope scope("getClosestRotEntries");
+   Profiler::count(ProfileCounter::NearestLookups);
+   std::vector<int> indices;
+   if (m_rotField)
+      m_rotField->index.kNearest(lon, lat, count, indices);
+
+   QgsFeatureList features;
+   for (int idx : indices)
+      features << m_rotFeatureList.at(idx);
+   return features;
 }
@@ -17,12 +17,19 @@
 #include <iostream>
 #include <QAction>
 #include <QApplication>
+#include <QMap>
+#include <QPointer>
+#include <memory>
 #include "qgsVectorDataProvider.h"
 #include "qgssinglesymbolrenderer.h"
 #include "qgsmaplayeractionregistry.h"
 #include "qgssymbol.h."
 #include <QVariant>
 #include <qgslogger.h> // For logging potential errors
+#include "pluginLog.h"
+#include "profiler.h"
+#include "rotationModel.h"
+#include "yhsTrackTask.h"
 
 
 class pnwRotationPlugin : public QObject, public QgisPlugin
@@ -43,26 +50,30 @@ public:
    /// @brief Called when the plugin is unloaded.
    virtual void unload() override;
 
-   struct pState
-   {
-      double lon;     // deg
-      double lat;     // deg
-      double ve;      // mm/Y
-      double vn;      // mm/Y
-   };
+   using pState = TrackState; // lon, lat deg; ve, vn mm/Y
 
 public slots:
    void clear_menu_button_action();
    void rot_menu_button_action();
    void yhs_menu_button_action();
+   void yhs_steps_ready(int runId, QVector<YhsTrackStep> steps);
+   void yhs_ensemble_menu_button_action();
+   void profile_menu_button_action(bool enabled);
+   void profile_summary_menu_button_action();
+   void verbose_menu_button_action(bool verbose);
 
 private:
    QgisInterface* m_qgis_if;
+   PluginLog m_log; // batched into the QGIS message log on the GUI thread
 
    /// The actions in the QGIS menu bar.
    QAction *m_clear_menu_action;
    QAction *m_display_rot_menu_action;
    QAction *m_yhs_menu_action;
+   QAction *m_yhs_ensemble_menu_action;
+   QAction *m_profile_menu_action;
+   QAction *m_profile_summary_menu_action;
+   QAction *m_verbose_menu_action;
 
    QgsVectorLayer *m_rotSrcLayer = NULL;
    QgsVectorLayer *m_rotDestLayer = NULL;
@@ -74,10 +85,22 @@ private:
    QgsFeatureList m_yhsFeatureList;
    std::vector<QString> m_fieldNames;
    std::vector<std::vector<double>> m_rot_data;
+   std::shared_ptr<RotFieldSnapshot> m_rotField; // indexed copy of m_rotFeatureList for lookups and runs
    std::vector<pState> m_pYhsState;
-   QgsPolylineXY m_line;
+   int m_rotFeaturesShown = 0;             // m_rotFeatureList2 entries already in m_rotDestLayer
+
+   // A background track run and its track feature
+   struct YhsRun
+   {
+      QgsPolylineXY line;
+      QgsFeatureId fid = FID_NULL;         // geometry updated in place as batches arrive
+      QPointer<YhsTrackTask> task;         // owned by the QGIS task manager
+   };
+   QMap<int, YhsRun> m_yhsRuns;
+   int m_nextRunId = 0;
+   QPointer<YhsEnsembleTask> m_ensembleTask;
+   int m_ensembleRuns = 0;
 
-   bool m_verbose = true;
    bool m_layers_setup = false;
    bool m_rotDataLoaded = false;
    bool m_yhsDataLoaded = false;
@@ -85,6 +108,8 @@ private:
    double m_passes;
    double m_NA_Vel_N; 
    double m_NA_Vel_E;
+   RotationModel m_rotationModel; // GPlates model, replaces the NA constants when it loads
+   bool m_rotationModelLoaded = false;
 
    // All valocity units match the Zeng data: mm/yr 
    // YHS current center
@@ -97,20 +122,42 @@ private:
    // W (270 degrees) @ 15 - 25 mm/yr earlier (relative to hotspot)
    const double NA_Speed = 38.0; // mm/yr
    const double NA_Bearing = 225.0;
+   const int NA_PlateId = 101;    // rotation model plate ids
+   const int mantlePlateId = 0;   // absolute (hotspot) reference frame
    const double detlaT = 1E6; // 1 million year intervals
    const double longitudeLimit = -126.0;
+   const int repaintIntervalMs = 250; // background runs hand back steps at most this often
+   const int logFlushIntervalMs = 500;
+   VelocityGridParams m_velocityGridParams; // step <= 0 samples the nearest station instead
+   const TrackIntegrator trackIntegrator = TrackIntegrator::RK45;
+   const double trackToleranceKm = 1.0; // RK45 position error per step
+
+   // Ensemble spread, station velocities are perturbed within their Se / Sn
+   const int ensembleMembers = 2000;
+   const double NA_SpeedSigma = 5.0;    // mm/yr
+   const double NA_BearingSigma = 10.0; // deg
+   const double ensembleCellDeg = 0.1;  // density raster cell
 
    bool setupLayers();
    bool loadRotData();
+   bool loadRotationModel();
    bool setupRotLayer();
    bool setupYhsLayer();
    void displayRotData(QgsFeatureList& featureList);
-   void displayYhsData(QgsPolylineXY& list);
+   void displayYhsData(YhsRun &run);
+   void appendRotData();
+   void showLayer(QgsVectorLayer *layer);
+   void loadVelocityGrid(RotFieldSnapshot &field, const std::vector<double> &lons, const std::vector<double> &lats);
+   void yhsRunFinished(int runId, bool completed, int steps, long long evaluations);
+   void cancelYhsRuns();
+   void displayEnsemble(const EnsembleParams &params, const EnsembleResult &result);
+   bool writeDensityRaster(const EnsembleResult &result, const QString &fileName);
+   void removeLayers(const QString &layerName);
    double getFeatureAttrubute(QgsFeature &feature, int index);
    bool setFeatureAttribute(QgsFeature &feature, int index, double value);
    QgsFeature getClosestRotEntry(double lon, double lat);
+   QgsFeatureList getClosestRotEntries(double lon, double lat, int count);
    void clear_display_data();
-   void printFeature (QgsFeature feature, QString label, int fields = 4);
 
    // Meters N,E to lat, Lon
    double latitudeFromDisatnce(double d);
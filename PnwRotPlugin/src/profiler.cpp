@@ -0,0 +1,131 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+   // Small stable ids for the trace viewer rows
+   int threadId()
+   {
+      static std::atomic<int> nextId{1};
+      thread_local const int id = nextId++;
+      return id;
+   }
+}
+
+Profiler &Profiler::instance()
+{
+   static Profiler profiler;
+   return profiler;
+}
+
+Profiler::Profiler() : m_epoch(std::chrono::steady_clock::now())
+{
+}
+
+int64_t Profiler::now() const
+{
+   return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+void Profiler::record(const char *name, int64_t start, int64_t end)
+{
+   const Event event = {name, start, end - start, threadId()};
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if (m_events.size() < MAX_EVENTS)
+      m_events.push_back(event);
+   else
+      m_events[m_nextEvent] = event;
+   m_nextEvent = (m_nextEvent + 1) % MAX_EVENTS;
+
+   auto it = std::find_if(m_stats.begin(), m_stats.end(), [name](const ScopeStats &s) { return s.name == name; });
+   if (it == m_stats.end())
+      m_stats.push_back({name, 1, event.duration, event.duration});
+   else
+   {
+      it->calls++;
+      it->total += event.duration;
+      it->max = std::max(it->max, event.duration);
+   }
+}
+
+void Profiler::reset()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_events.clear();
+   m_nextEvent = 0;
+   m_stats.clear();
+   for (std::atomic<long long> &counter : m_counters)
+      counter = 0;
+}
+
+const char *Profiler::counterName(ProfileCounter counter)
+{
+   switch (counter)
+   {
+   case ProfileCounter::FeaturesScanned:
+      return "features scanned";
+   case ProfileCounter::FeaturesAdded:
+      return "features added";
+   case ProfileCounter::Repaints:
+      return "repaints";
+   case ProfileCounter::NearestLookups:
+      return "nearest lookups";
+   default:
+      return "";
+   }
+}
+
+bool Profiler::writeChromeTrace(const std::string &fileName) const
+{
+   FILE *file = std::fopen(fileName.c_str(), "w");
+   if (!file)
+      return false;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+   bool first = true;
+   int64_t last = 0;
+   for (const Event &e : m_events)
+   {
+      std::fprintf(file, "%s{\"name\": \"%s\", \"cat\": \"pnwRotation\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %lld, \"dur\": %lld}",
+                   first ? "" : ",\n", e.name, e.thread, (long long)e.start, (long long)e.duration);
+      first = false;
+      last = std::max(last, e.start + e.duration);
+   }
+   for (int c = 0; c < (int)ProfileCounter::Count; c++)
+   {
+      std::fprintf(file, "%s{\"name\": \"%s\", \"cat\": \"pnwRotation\", \"ph\": \"C\", \"pid\": 1, \"ts\": %lld, \"args\": {\"value\": %lld}}",
+                   first ? "" : ",\n", counterName((ProfileCounter)c), (long long)last, m_counters[c].load());
+      first = false;
+   }
+   std::fprintf(file, "\n]}\n");
+   return std::fclose(file) == 0;
+}
+
+std::string Profiler::summary() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+
+   std::vector<ScopeStats> stats = m_stats;
+   std::sort(stats.begin(), stats.end(), [](const ScopeStats &a, const ScopeStats &b) { return a.total > b.total; });
+
+   std::string text;
+   char line[256];
+   std::snprintf(line, sizeof(line), "%-28s %10s %12s %10s %10s\n", "scope", "calls", "total ms", "mean ms", "max ms");
+   text += line;
+   for (const ScopeStats &s : stats)
+   {
+      std::snprintf(line, sizeof(line), "%-28s %10lld %12.3f %10.3f %10.3f\n", s.name, s.calls,
+                    s.total / 1000.0, s.total / 1000.0 / s.calls, s.max / 1000.0);
+      text += line;
+   }
+   text += "\n";
+   for (int c = 0; c < (int)ProfileCounter::Count; c++)
+   {
+      std::snprintf(line, sizeof(line), "%-28s %10lld\n", counterName((ProfileCounter)c), m_counters[c].load());
+      text += line;
+   }
+   return text;
+}
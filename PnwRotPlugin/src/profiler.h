@@ -0,0 +1,109 @@
+#ifndef _QGIS_pnwRotationPlugin_PROFILER_H_
+#define _QGIS_pnwRotationPlugin_PROFILER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class ProfileCounter
+{
+   FeaturesScanned, // source layer features read
+   FeaturesAdded,   // features written to plugin layers
+   Repaints,        // triggerRepaint calls
+   NearestLookups,  // station index queries from the GUI thread
+   Count
+};
+
+// Process wide scoped timers and counters, off until enabled.
+// While disabled a scope or counter costs one relaxed atomic load.
+// Scope names must be string literals, they are kept by pointer.
+class Profiler
+{
+public:
+   static Profiler &instance();
+
+   void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+   bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+   static void count(ProfileCounter counter, long long n = 1)
+   {
+      Profiler &p = instance();
+      if (p.enabled())
+         p.m_counters[(int)counter].fetch_add(n, std::memory_order_relaxed);
+   }
+
+   /// @brief Microseconds since the profiler was created
+   int64_t now() const;
+   void record(const char *name, int64_t start, int64_t end);
+
+   /// @brief Drop all events and zero the counters
+   void reset();
+
+   /// @brief Chrome trace event JSON (chrome://tracing, Perfetto): one complete
+   /// event per scope plus the final counter values
+   bool writeChromeTrace(const std::string &fileName) const;
+
+   /// @brief Per scope calls, total / mean / max ms and the counters, as text
+   std::string summary() const;
+
+   static const char *counterName(ProfileCounter counter);
+
+private:
+   Profiler();
+
+   struct Event
+   {
+      const char *name;
+      int64_t start; // us
+      int64_t duration;
+      int thread;
+   };
+
+   static const size_t MAX_EVENTS = 1 << 20; // older scopes still count in the summary
+
+   struct ScopeStats
+   {
+      const char *name;
+      long long calls;
+      int64_t total;
+      int64_t max;
+   };
+
+   std::atomic<bool> m_enabled{false};
+   std::array<std::atomic<long long>, (size_t)ProfileCounter::Count> m_counters{};
+   const std::chrono::steady_clock::time_point m_epoch;
+
+   mutable std::mutex m_mutex;
+   std::vector<Event> m_events;         // ring once MAX_EVENTS is reached
+   size_t m_nextEvent = 0;
+   std::vector<ScopeStats> m_stats;     // few scopes, linear lookup by pointer
+};
+
+// Times its enclosing block when the profiler is enabled on entry
+class ProfileScope
+{
+public:
+   explicit ProfileScope(const char *name)
+       : m_name(Profiler::instance().enabled() ? name : nullptr),
+         m_start(m_name ? Profiler::instance().now() : 0)
+   {
+   }
+   ~ProfileScope()
+   {
+      if (m_name)
+         Profiler::instance().record(m_name, m_start, Profiler::instance().now());
+   }
+
+   ProfileScope(const ProfileScope &) = delete;
+   ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+   const char *m_name;
+   int64_t m_start;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include "reconstruction.h"
+#include "parallelFor.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PNW_X86 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+namespace
+{
+   const double DEG_PER_RAD = 180.0 / 3.14159265358979323846;
+}
+
+void PlatePointSet::addPlate(int plate, const std::vector<double> &lon, const std::vector<double> &lat)
+{
+   const size_t count = std::min(lon.size(), lat.size());
+   for (size_t n = 0; n < count; n++)
+   {
+      const double phi = lat[n] / DEG_PER_RAD;
+      const double lambda = lon[n] / DEG_PER_RAD;
+      x.push_back(std::cos(phi) * std::cos(lambda));
+      y.push_back(std::cos(phi) * std::sin(lambda));
+      z.push_back(std::sin(phi));
+   }
+   plates.push_back(plate);
+   offsets.push_back(x.size());
+}
+
+void PlatePointSet::clear()
+{
+   plates.clear();
+   offsets.assign(1, 0);
+   x.clear();
+   y.clear();
+   z.clear();
+}
+
+void ReconstructedSlice::toLonLat(std::vector<double> &lon, std::vector<double> &lat) const
+{
+   lon.resize(x.size());
+   lat.resize(x.size());
+   for (size_t n = 0; n < x.size(); n++)
+   {
+      lon[n] = std::atan2(y[n], x[n]) * DEG_PER_RAD;
+      lat[n] = std::atan2(z[n], std::hypot(x[n], y[n])) * DEG_PER_RAD;
+   }
+}
+
+void rotationMatrix(const RotationQuat &q, double m[9])
+{
+   const double xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+   const double xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+   const double wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+   m[0] = 1 - 2 * (yy + zz);
+   m[1] = 2 * (xy - wz);
+   m[2] = 2 * (xz + wy);
+   m[3] = 2 * (xy + wz);
+   m[4] = 1 - 2 * (xx + zz);
+   m[5] = 2 * (yz - wx);
+   m[6] = 2 * (xz - wy);
+   m[7] = 2 * (yz + wx);
+   m[8] = 1 - 2 * (xx + yy);
+}
+
+void rotatePointsScalar(const double m[9], const double *x, const double *y, const double *z,
+                        double *ox, double *oy, double *oz, size_t count)
+{
+   for (size_t n = 0; n < count; n++)
+   {
+      ox[n] = m[0] * x[n] + m[1] * y[n] + m[2] * z[n];
+      oy[n] = m[3] * x[n] + m[4] * y[n] + m[5] * z[n];
+      oz[n] = m[6] * x[n] + m[7] * y[n] + m[8] * z[n];
+   }
+}
+
+#ifdef PNW_X86
+
+void rotatePointsSSE2(const double m[9], const double *x, const double *y, const double *z,
+                      double *ox, double *oy, double *oz, size_t count)
+{
+   __m128d r[9];
+   for (int i = 0; i < 9; i++)
+      r[i] = _mm_set1_pd(m[i]);
+
+   const size_t vecCount = count & ~(size_t)1;
+   for (size_t n = 0; n < vecCount; n += 2)
+   {
+      const __m128d px = _mm_loadu_pd(x + n);
+      const __m128d py = _mm_loadu_pd(y + n);
+      const __m128d pz = _mm_loadu_pd(z + n);
+      _mm_storeu_pd(ox + n, _mm_add_pd(_mm_add_pd(_mm_mul_pd(r[0], px), _mm_mul_pd(r[1], py)), _mm_mul_pd(r[2], pz)));
+      _mm_storeu_pd(oy + n, _mm_add_pd(_mm_add_pd(_mm_mul_pd(r[3], px), _mm_mul_pd(r[4], py)), _mm_mul_pd(r[5], pz)));
+      _mm_storeu_pd(oz + n, _mm_add_pd(_mm_add_pd(_mm_mul_pd(r[6], px), _mm_mul_pd(r[7], py)), _mm_mul_pd(r[8], pz)));
+   }
+
+   rotatePointsScalar(m, x + vecCount, y + vecCount, z + vecCount, ox + vecCount, oy + vecCount, oz + vecCount, count - vecCount);
+}
+
+namespace
+{
+   bool cpuHasAvx2()
+   {
+#ifdef _MSC_VER
+      int info[4];
+      __cpuid(info, 0);
+      if (info[0] < 7)
+         return false;
+      __cpuid(info, 1);
+      const bool osxsave = (info[2] & (1 << 27)) != 0;
+      const bool avx = (info[2] & (1 << 28)) != 0;
+      __cpuidex(info, 7, 0);
+      const bool avx2 = (info[1] & (1 << 5)) != 0;
+      // OS must save the YMM state too
+      return osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+   }
+}
+
+ReconstructSimd detectReconstructSimd()
+{
+   static const ReconstructSimd level = cpuHasAvx2() ? ReconstructSimd::AVX2 : ReconstructSimd::SSE2;
+   return level;
+}
+
+#else
+
+void rotatePointsSSE2(const double m[9], const double *x, const double *y, const double *z,
+                      double *ox, double *oy, double *oz, size_t count)
+{
+   rotatePointsScalar(m, x, y, z, ox, oy, oz, count);
+}
+
+ReconstructSimd detectReconstructSimd()
+{
+   return ReconstructSimd::Scalar;
+}
+
+#endif
+
+const char *reconstructSimdName(ReconstructSimd level)
+{
+   switch (level)
+   {
+   case ReconstructSimd::AVX2:
+      return "AVX2";
+   case ReconstructSimd::SSE2:
+      return "SSE2";
+   default:
+      return "Scalar";
+   }
+}
+
+void reconstructPoints(const RotationModel &model, int anchor, const PlatePointSet &points,
+                       const std::vector<double> &times, std::vector<ReconstructedSlice> &slices,
+                       int threads, ReconstructSimd simd)
+{
+   const int groups = points.groupCount();
+   const int T = (int)times.size();
+
+   // Compose each (plate, time) rotation once, the cache shares the hierarchy between plates
+   RotationCache cache;
+   std::vector<double> matrices((size_t)T * groups * 9);
+   for (int t = 0; t < T; t++)
+   {
+      for (int g = 0; g < groups; g++)
+         rotationMatrix(model.rotationBetween(points.plates[g], anchor, times[t], &cache), &matrices[((size_t)t * groups + g) * 9]);
+   }
+
+   slices.resize(T);
+   for (int t = 0; t < T; t++)
+   {
+      slices[t].time = times[t];
+      slices[t].x.resize(points.size());
+      slices[t].y.resize(points.size());
+      slices[t].z.resize(points.size());
+   }
+
+   // Work items never straddle a plate group, so each uses a single matrix
+   struct Span
+   {
+      int group;
+      size_t begin;
+      size_t end;
+   };
+   std::vector<Span> spans;
+   for (int g = 0; g < groups; g++)
+   {
+      for (size_t begin = points.offsets[g]; begin < points.offsets[g + 1]; begin += RECONSTRUCT_BLOCK)
+         spans.push_back({g, begin, std::min(points.offsets[g + 1], begin + RECONSTRUCT_BLOCK)});
+   }
+
+   const int S = (int)spans.size();
+   parallelFor(T * S, [&](int item)
+   {
+      const int t = item / S;
+      const Span &span = spans[item % S];
+      const double *m = &matrices[((size_t)t * groups + span.group) * 9];
+      ReconstructedSlice &slice = slices[t];
+      const size_t n = span.begin;
+      const size_t count = span.end - span.begin;
+      switch (simd)
+      {
+      case ReconstructSimd::AVX2:
+         rotatePointsAVX2(m, &points.x[n], &points.y[n], &points.z[n], &slice.x[n], &slice.y[n], &slice.z[n], count);
+         break;
+      case ReconstructSimd::SSE2:
+         rotatePointsSSE2(m, &points.x[n], &points.y[n], &points.z[n], &slice.x[n], &slice.y[n], &slice.z[n], count);
+         break;
+      default:
+         rotatePointsScalar(m, &points.x[n], &points.y[n], &points.z[n], &slice.x[n], &slice.y[n], &slice.z[n], count);
+         break;
+      }
+   }, threads);
+}
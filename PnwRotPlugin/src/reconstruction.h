@@ -0,0 +1,67 @@
+#ifndef _QGIS_pnwRotationPlugin_RECONSTRUCTION_H_
+#define _QGIS_pnwRotationPlugin_RECONSTRUCTION_H_
+
+#include "rotationModel.h"
+#include <cstddef>
+#include <vector>
+
+enum class ReconstructSimd
+{
+   Scalar,
+   SSE2,
+   AVX2
+};
+
+const size_t RECONSTRUCT_BLOCK = 16384; // points per work item
+
+// Unit ECEF points in SoA layout, grouped by plate.
+// Group g holds points [offsets[g], offsets[g + 1]) and rotates with plates[g].
+struct PlatePointSet
+{
+   std::vector<int> plates;
+   std::vector<size_t> offsets = {0};
+   std::vector<double> x;
+   std::vector<double> y;
+   std::vector<double> z;
+
+   /// @brief Append a plate group from lon / lat in deg
+   void addPlate(int plate, const std::vector<double> &lon, const std::vector<double> &lat);
+   void clear();
+
+   size_t size() const { return x.size(); }
+   int groupCount() const { return (int)plates.size(); }
+};
+
+// All points of a PlatePointSet at one reconstruction time, same order
+struct ReconstructedSlice
+{
+   double time = 0; // Ma
+   std::vector<double> x;
+   std::vector<double> y;
+   std::vector<double> z;
+
+   void toLonLat(std::vector<double> &lon, std::vector<double> &lat) const;
+};
+
+/// @brief Row major 3x3 matrix of a unit quaternion
+void rotationMatrix(const RotationQuat &q, double m[9]);
+
+// out = m p for count SoA points. Outputs must not alias inputs.
+void rotatePointsScalar(const double m[9], const double *x, const double *y, const double *z,
+                        double *ox, double *oy, double *oz, size_t count);
+void rotatePointsSSE2(const double m[9], const double *x, const double *y, const double *z,
+                      double *ox, double *oy, double *oz, size_t count);
+void rotatePointsAVX2(const double m[9], const double *x, const double *y, const double *z,
+                      double *ox, double *oy, double *oz, size_t count);
+
+ReconstructSimd detectReconstructSimd();
+const char *reconstructSimdName(ReconstructSimd level);
+
+/// @brief Reconstruct every point to every time relative to anchor.
+/// Rotations are composed once per (plate, time) on the calling thread,
+/// the rotation kernels then run across threads in blocks.
+void reconstructPoints(const RotationModel &model, int anchor, const PlatePointSet &points,
+                       const std::vector<double> &times, std::vector<ReconstructedSlice> &slices,
+                       int threads = 0, ReconstructSimd simd = detectReconstructSimd());
+
+#endif
@@ -0,0 +1,38 @@
+// Compiled with AVX2 code generation (see CMakeLists.txt) - only reached
+// through detectReconstructSimd() on CPUs that report AVX2.
+#include "reconstruction.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+void rotatePointsAVX2(const double m[9], const double *x, const double *y, const double *z,
+                      double *ox, double *oy, double *oz, size_t count)
+{
+   __m256d r[9];
+   for (int i = 0; i < 9; i++)
+      r[i] = _mm256_set1_pd(m[i]);
+
+   const size_t vecCount = count & ~(size_t)3;
+   for (size_t n = 0; n < vecCount; n += 4)
+   {
+      const __m256d px = _mm256_loadu_pd(x + n);
+      const __m256d py = _mm256_loadu_pd(y + n);
+      const __m256d pz = _mm256_loadu_pd(z + n);
+      _mm256_storeu_pd(ox + n, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r[0], px), _mm256_mul_pd(r[1], py)), _mm256_mul_pd(r[2], pz)));
+      _mm256_storeu_pd(oy + n, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r[3], px), _mm256_mul_pd(r[4], py)), _mm256_mul_pd(r[5], pz)));
+      _mm256_storeu_pd(oz + n, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r[6], px), _mm256_mul_pd(r[7], py)), _mm256_mul_pd(r[8], pz)));
+   }
+
+   // Remainder through the SSE2 kernel (defined in the baseline unit)
+   rotatePointsSSE2(m, x + vecCount, y + vecCount, z + vecCount, ox + vecCount, oy + vecCount, oz + vecCount, count - vecCount);
+}
+
+#else
+
+void rotatePointsAVX2(const double m[9], const double *x, const double *y, const double *z,
+                      double *ox, double *oy, double *oz, size_t count)
+{
+   rotatePointsSSE2(m, x, y, z, ox, oy, oz, count);
+}
+
+#endif
@@ -0,0 +1,268 @@
+#include "rotationModel.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+   const double DEG_PER_RAD = 180.0 / 3.14159265358979323846;
+   const double EARTH_RADIUS_MM = 6371000.0 * 1000;
+   const int COMMENT_PLATE = 999;
+   const int MAX_HIERARCHY_DEPTH = 64; // guards against cycles in a broken file
+
+   std::atomic<uint64_t> s_generation{0};
+
+   void unitVector(double lat, double lon, double v[3])
+   {
+      const double phi = lat / DEG_PER_RAD;
+      const double lambda = lon / DEG_PER_RAD;
+      v[0] = std::cos(phi) * std::cos(lambda);
+      v[1] = std::cos(phi) * std::sin(lambda);
+      v[2] = std::sin(phi);
+   }
+
+   void toLonLat(const double v[3], double &lon, double &lat)
+   {
+      lat = std::atan2(v[2], std::hypot(v[0], v[1])) * DEG_PER_RAD;
+      lon = std::atan2(v[1], v[0]) * DEG_PER_RAD;
+   }
+}
+
+RotationQuat RotationQuat::fromPole(double lat, double lon, double angle)
+{
+   double axis[3];
+   unitVector(lat, lon, axis);
+   const double half = 0.5 * angle / DEG_PER_RAD;
+   const double s = std::sin(half);
+   return {std::cos(half), s * axis[0], s * axis[1], s * axis[2]};
+}
+
+void RotationQuat::rotate(const double v[3], double out[3]) const
+{
+   // v' = v + 2w (u x v) + 2 u x (u x v), u = (x, y, z)
+   const double t[3] = {2 * (y * v[2] - z * v[1]),
+                        2 * (z * v[0] - x * v[2]),
+                        2 * (x * v[1] - y * v[0])};
+   const double r[3] = {v[0] + w * t[0] + (y * t[2] - z * t[1]),
+                        v[1] + w * t[1] + (z * t[0] - x * t[2]),
+                        v[2] + w * t[2] + (x * t[1] - y * t[0])};
+   out[0] = r[0];
+   out[1] = r[1];
+   out[2] = r[2];
+}
+
+RotationQuat slerp(const RotationQuat &a, const RotationQuat &b, double t)
+{
+   double dot = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+   RotationQuat c = b;
+   if (dot < 0) // q and -q are the same rotation, take the short way round
+   {
+      dot = -dot;
+      c = {-b.w, -b.x, -b.y, -b.z};
+   }
+
+   double ka, kb;
+   if (dot > 0.9999995)
+   {
+      ka = 1 - t; // nearly parallel, linear is exact to rounding
+      kb = t;
+   }
+   else
+   {
+      const double theta = std::acos(dot);
+      const double s = std::sin(theta);
+      ka = std::sin((1 - t) * theta) / s;
+      kb = std::sin(t * theta) / s;
+   }
+
+   RotationQuat q = {ka * a.w + kb * c.w, ka * a.x + kb * c.x, ka * a.y + kb * c.y, ka * a.z + kb * c.z};
+   const double norm = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+   return {q.w / norm, q.x / norm, q.y / norm, q.z / norm};
+}
+
+size_t RotationCache::KeyHash::operator()(const Key &k) const
+{
+   uint64_t bits;
+   std::memcpy(&bits, &k.time, sizeof(bits));
+   uint64_t h = bits * 0x9E3779B97F4A7C15ull ^ (uint64_t)(uint32_t)k.plate;
+   return (size_t)(h ^ (h >> 29));
+}
+
+void RotationModel::clear()
+{
+   m_sequences.clear();
+   m_plateSequences.clear();
+   m_error.clear();
+   m_generation = ++s_generation;
+}
+
+bool RotationModel::load(const std::string &filename)
+{
+   clear();
+   std::ifstream file(filename);
+   if (!file)
+   {
+      m_error = "Could not open " + filename;
+      return false;
+   }
+
+   std::string line;
+   int lineNumber = 0;
+   int malformed = 0;
+   while (std::getline(file, line))
+   {
+      lineNumber++;
+      const char *p = line.c_str();
+      char *end;
+
+      const long moving = std::strtol(p, &end, 10);
+      if (end == p)
+         continue; // blank line
+      if (moving == COMMENT_PLATE)
+         continue;
+
+      double values[4]; // age, lat, lon, angle
+      bool ok = true;
+      for (double &value : values)
+      {
+         p = end;
+         value = std::strtod(p, &end);
+         ok = ok && end != p;
+      }
+      p = end;
+      const long fixed = std::strtol(p, &end, 10);
+      if (!ok || end == p)
+      {
+         if (malformed++ == 0)
+            m_error = "Malformed line " + std::to_string(lineNumber);
+         continue;
+      }
+
+      // A new moving / fixed pair starts a new sequence
+      if (m_sequences.empty() || m_sequences.back().moving != moving || m_sequences.back().fixed != fixed)
+      {
+         m_plateSequences[(int)moving].push_back((int)m_sequences.size());
+         m_sequences.push_back({(int)moving, (int)fixed, {}});
+      }
+      m_sequences.back().samples.push_back({values[0], RotationQuat::fromPole(values[1], values[2], values[3])});
+   }
+
+   for (Sequence &sequence : m_sequences)
+      std::stable_sort(sequence.samples.begin(), sequence.samples.end(),
+                       [](const Sample &a, const Sample &b) { return a.time < b.time; });
+
+   if (malformed)
+      m_error += " (" + std::to_string(malformed) + " malformed lines skipped)";
+   return !m_sequences.empty();
+}
+
+bool RotationModel::relativeRotation(int plate, double time, RotationQuat &q, int &fixedPlate) const
+{
+   auto it = m_plateSequences.find(plate);
+   if (it == m_plateSequences.end())
+      return false;
+
+   // The first sequence in file order covering time wins, as in GPlates
+   for (int id : it->second)
+   {
+      const std::vector<Sample> &samples = m_sequences[id].samples;
+      if (time < samples.front().time || time > samples.back().time)
+         continue;
+
+      fixedPlate = m_sequences[id].fixed;
+      auto upper = std::upper_bound(samples.begin(), samples.end(), time,
+                                    [](double t, const Sample &s) { return t < s.time; });
+      if (upper == samples.end())
+      {
+         q = samples.back().q; // time is the last sample
+         return true;
+      }
+
+      const Sample &hi = *upper;
+      const Sample &lo = *(upper - 1);
+      const double span = hi.time - lo.time;
+      q = span > 0 ? slerp(lo.q, hi.q, (time - lo.time) / span) : hi.q;
+      return true;
+   }
+   return false;
+}
+
+RotationQuat RotationModel::totalRotation(int plate, double time, RotationCache *cache) const
+{
+   return totalRotation(plate, time, cache, 0);
+}
+
+RotationQuat RotationModel::totalRotation(int plate, double time, RotationCache *cache, int depth) const
+{
+   if (plate == 0 || depth > MAX_HIERARCHY_DEPTH)
+      return RotationQuat();
+
+   if (cache)
+   {
+      if (cache->m_generation != m_generation)
+      {
+         cache->m_entries.clear();
+         cache->m_generation = m_generation;
+      }
+      auto it = cache->m_entries.find({plate, time});
+      if (it != cache->m_entries.end())
+         return it->second;
+   }
+
+   // Rotate within the fixed plate first, then carry the fixed plate to plate 0
+   RotationQuat relative;
+   int fixedPlate = 0;
+   RotationQuat total;
+   if (relativeRotation(plate, time, relative, fixedPlate))
+      total = totalRotation(fixedPlate, time, cache, depth + 1) * relative;
+
+   if (cache)
+      cache->m_entries.emplace(RotationCache::Key{plate, time}, total);
+   return total;
+}
+
+RotationQuat RotationModel::rotationBetween(int plate, int anchor, double time, RotationCache *cache) const
+{
+   const RotationQuat total = totalRotation(plate, time, cache);
+   if (anchor == 0)
+      return total;
+   return totalRotation(anchor, time, cache).inverse() * total;
+}
+
+void RotationModel::reconstruct(int plate, int anchor, double time, double lon, double lat,
+                                double &outLon, double &outLat, RotationCache *cache) const
+{
+   double v[3];
+   unitVector(lat, lon, v);
+   rotationBetween(plate, anchor, time, cache).rotate(v, v);
+   toLonLat(v, outLon, outLat);
+}
+
+void RotationModel::plateVelocity(int plate, int anchor, double time, double lon, double lat,
+                                  double &ve, double &vn, RotationCache *cache, double halfStep) const
+{
+   // Carry the point back to present day, then to the bracketing ages
+   const double older = time + halfStep;
+   const double younger = std::max(0.0, time - halfStep);
+   const RotationQuat now = rotationBetween(plate, anchor, time, cache);
+   const RotationQuat toOlder = rotationBetween(plate, anchor, older, cache) * now.inverse();
+   const RotationQuat toYounger = rotationBetween(plate, anchor, younger, cache) * now.inverse();
+
+   double p[3], pOld[3], pYoung[3];
+   unitVector(lat, lon, p);
+   toOlder.rotate(p, pOld);
+   toYounger.rotate(p, pYoung);
+
+   // Chord over the interval as a velocity in the local east / north frame
+   const double years = (older - younger) * 1E6;
+   const double d[3] = {pYoung[0] - pOld[0], pYoung[1] - pOld[1], pYoung[2] - pOld[2]};
+   const double phi = lat / DEG_PER_RAD;
+   const double lambda = lon / DEG_PER_RAD;
+   const double east[3] = {-std::sin(lambda), std::cos(lambda), 0};
+   const double north[3] = {-std::sin(phi) * std::cos(lambda), -std::sin(phi) * std::sin(lambda), std::cos(phi)};
+   ve = (d[0] * east[0] + d[1] * east[1] + d[2] * east[2]) * EARTH_RADIUS_MM / years;
+   vn = (d[0] * north[0] + d[1] * north[1] + d[2] * north[2]) * EARTH_RADIUS_MM / years;
+}
@@ -0,0 +1,125 @@
+#ifndef _QGIS_pnwRotationPlugin_ROTATION_MODEL_H_
+#define _QGIS_pnwRotationPlugin_ROTATION_MODEL_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Unit quaternion rotation w + xi + yj + zk
+struct RotationQuat
+{
+   double w = 1;
+   double x = 0;
+   double y = 0;
+   double z = 0;
+
+   /// @brief Finite rotation about the pole lat, lon by angle, all in deg (right hand rule)
+   static RotationQuat fromPole(double lat, double lon, double angle);
+
+   RotationQuat operator*(const RotationQuat &b) const
+   {
+      return {w * b.w - x * b.x - y * b.y - z * b.z,
+              w * b.x + x * b.w + y * b.z - z * b.y,
+              w * b.y - x * b.z + y * b.w + z * b.x,
+              w * b.z + x * b.y - y * b.x + z * b.w};
+   }
+   RotationQuat inverse() const { return {w, -x, -y, -z}; }
+
+   /// @brief out = q v q*, v and out may alias
+   void rotate(const double v[3], double out[3]) const;
+};
+
+/// @brief Shortest arc interpolation, t in [0, 1]
+RotationQuat slerp(const RotationQuat &a, const RotationQuat &b, double t);
+
+class RotationModel;
+
+// Memo of composed rotations keyed by (plate, time).
+// Not thread safe, keep one per thread. Entries are dropped automatically
+// when the model is reloaded.
+class RotationCache
+{
+public:
+   void clear() { m_entries.clear(); }
+   size_t size() const { return m_entries.size(); }
+
+private:
+   friend class RotationModel;
+
+   struct Key
+   {
+      int plate;
+      double time;
+      bool operator==(const Key &b) const { return plate == b.plate && time == b.time; }
+   };
+   struct KeyHash
+   {
+      size_t operator()(const Key &k) const;
+   };
+
+   uint64_t m_generation = 0;
+   std::unordered_map<Key, RotationQuat, KeyHash> m_entries;
+};
+
+// GPlates .rot rotation model.
+// Each line is "moving age lat lon angle fixed ! comment". Consecutive lines
+// with the same moving / fixed pair form a time sorted sequence, a plate
+// may have several sequences over different age ranges (crossovers).
+// Rotations between samples are SLERP interpolated and total rotations are
+// composed up the fixed plate hierarchy to plate 0.
+// Ages are in Ma. A total rotation takes a present day point on the plate
+// to its position at that age.
+class RotationModel
+{
+public:
+   bool load(const std::string &filename);
+   void clear();
+
+   bool empty() const { return m_sequences.empty(); }
+   int sequenceCount() const { return (int)m_sequences.size(); }
+   int plateCount() const { return (int)m_plateSequences.size(); }
+   const std::string &error() const { return m_error; }
+
+   /// @brief Rotation of plate relative to its fixed plate at time.
+   /// @return false if no sequence of the plate covers time
+   bool relativeRotation(int plate, double time, RotationQuat &q, int &fixedPlate) const;
+
+   /// @brief Rotation of plate relative to plate 0, identity where the hierarchy has no entry
+   RotationQuat totalRotation(int plate, double time, RotationCache *cache = nullptr) const;
+
+   /// @brief Rotation of plate relative to anchor
+   RotationQuat rotationBetween(int plate, int anchor, double time, RotationCache *cache = nullptr) const;
+
+   /// @brief Position at time of the present day point lon, lat (deg) on plate, in the anchor frame
+   void reconstruct(int plate, int anchor, double time, double lon, double lat,
+                    double &outLon, double &outLat, RotationCache *cache = nullptr) const;
+
+   /// @brief Velocity (mm/yr) of plate relative to anchor at lon, lat (deg, anchor frame)
+   /// at time, from the stage rotation over time +- halfStep (Ma)
+   void plateVelocity(int plate, int anchor, double time, double lon, double lat,
+                      double &ve, double &vn, RotationCache *cache = nullptr, double halfStep = 0.5) const;
+
+private:
+   struct Sample
+   {
+      double time; // Ma
+      RotationQuat q;
+   };
+
+   struct Sequence
+   {
+      int moving;
+      int fixed;
+      std::vector<Sample> samples; // increasing time
+   };
+
+   std::vector<Sequence> m_sequences;
+   std::unordered_map<int, std::vector<int>> m_plateSequences; // sequence ids per moving plate, file order
+   std::string m_error;
+   uint64_t m_generation = 0;
+
+   RotationQuat totalRotation(int plate, double time, RotationCache *cache, int depth) const;
+};
+
+#endif
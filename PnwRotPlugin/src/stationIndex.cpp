@@ -0,0 +1,145 @@
+#define sqr(x) ((x) * (x))
+#include "stationIndex.h"
+#include <algorithm>
+
+void StationIndex::build(const std::vector<double> &lon, const std::vector<double> &lat)
+{
+   const int N = (int)std::min(lon.size(), lat.size());
+   m_nodes.resize(N);
+   for (int n = 0; n < N; n++)
+      m_nodes[n] = {{lon[n], lat[n]}, n};
+
+   buildRange(0, N, 0);
+}
+
+void StationIndex::clear()
+{
+   m_nodes.clear();
+}
+
+bool StationIndex::bounds(double &lonMin, double &lonMax, double &latMin, double &latMax) const
+{
+   if (m_nodes.empty())
+      return false;
+
+   lonMin = lonMax = m_nodes[0].p[0];
+   latMin = latMax = m_nodes[0].p[1];
+   for (const Node &node : m_nodes)
+   {
+      lonMin = std::min(lonMin, node.p[0]);
+      lonMax = std::max(lonMax, node.p[0]);
+      latMin = std::min(latMin, node.p[1]);
+      latMax = std::max(latMax, node.p[1]);
+   }
+   return true;
+}
+
+void StationIndex::buildRange(int lo, int hi, int axis)
+{
+   if (hi - lo < 2)
+      return;
+
+   const int mid = (lo + hi) / 2;
+   std::nth_element(m_nodes.begin() + lo, m_nodes.begin() + mid, m_nodes.begin() + hi,
+                    [axis](const Node &a, const Node &b) { return a.p[axis] < b.p[axis]; });
+
+   buildRange(lo, mid, axis ^ 1);
+   buildRange(mid + 1, hi, axis ^ 1);
+}
+
+int StationIndex::nearest(double lon, double lat, double *dist2) const
+{
+   if (m_nodes.empty())
+      return -1;
+
+   const double q[2] = {lon, lat};
+   Candidate best = {1e300, -1};
+   nearestRange(0, (int)m_nodes.size(), 0, q, best);
+
+   if (dist2)
+      *dist2 = best.dist2;
+   return best.id;
+}
+
+void StationIndex::nearestRange(int lo, int hi, int axis, const double q[2], Candidate &best) const
+{
+   if (lo >= hi)
+      return;
+
+   const int mid = (lo + hi) / 2;
+   const Node &node = m_nodes[mid];
+   const double dist = sqr(node.p[0] - q[0]) + sqr(node.p[1] - q[1]);
+   if (dist < best.dist2 || (dist == best.dist2 && node.id < best.id)) // lowest id wins ties, as the layer scan did
+      best = {dist, node.id};
+
+   // Descend the near side first, then the far side only if the split plane is within reach
+   const double delta = q[axis] - node.p[axis];
+   if (delta < 0)
+   {
+      nearestRange(lo, mid, axis ^ 1, q, best);
+      if (sqr(delta) <= best.dist2)
+         nearestRange(mid + 1, hi, axis ^ 1, q, best);
+   }
+   else
+   {
+      nearestRange(mid + 1, hi, axis ^ 1, q, best);
+      if (sqr(delta) <= best.dist2)
+         nearestRange(lo, mid, axis ^ 1, q, best);
+   }
+}
+
+int StationIndex::kNearest(double lon, double lat, int k, std::vector<int> &indices, std::vector<double> *dist2) const
+{
+   indices.clear();
+   if (dist2)
+      dist2->clear();
+   if (m_nodes.empty() || k <= 0)
+      return 0;
+
+   const auto closer = [](const Candidate &a, const Candidate &b) { return a.dist2 < b.dist2; };
+   const double q[2] = {lon, lat};
+   std::vector<Candidate> heap; // max-heap on distance, worst candidate at front
+   heap.reserve(k);
+   kNearestRange(0, (int)m_nodes.size(), 0, q, k, heap);
+
+   std::sort_heap(heap.begin(), heap.end(), closer);
+   for (const Candidate &c : heap)
+   {
+      indices.push_back(c.id);
+      if (dist2)
+         dist2->push_back(c.dist2);
+   }
+   return (int)indices.size();
+}
+
+void StationIndex::kNearestRange(int lo, int hi, int axis, const double q[2], int k, std::vector<Candidate> &heap) const
+{
+   if (lo >= hi)
+      return;
+
+   const auto closer = [](const Candidate &a, const Candidate &b) { return a.dist2 < b.dist2; };
+   const int mid = (lo + hi) / 2;
+   const Node &node = m_nodes[mid];
+   const double dist = sqr(node.p[0] - q[0]) + sqr(node.p[1] - q[1]);
+   if ((int)heap.size() < k)
+   {
+      heap.push_back({dist, node.id});
+      std::push_heap(heap.begin(), heap.end(), closer);
+   }
+   else if (dist < heap.front().dist2)
+   {
+      std::pop_heap(heap.begin(), heap.end(), closer);
+      heap.back() = {dist, node.id};
+      std::push_heap(heap.begin(), heap.end(), closer);
+   }
+
+   const double delta = q[axis] - node.p[axis];
+   const int nearLo = delta < 0 ? lo : mid + 1;
+   const int nearHi = delta < 0 ? mid : hi;
+   const int farLo = delta < 0 ? mid + 1 : lo;
+   const int farHi = delta < 0 ? hi : mid;
+
+   kNearestRange(nearLo, nearHi, axis ^ 1, q, k, heap);
+   if ((int)heap.size() < k || sqr(delta) < heap.front().dist2)
+      kNearestRange(farLo, farHi, axis ^ 1, q, k, heap);
+}
@@ -0,0 +1,52 @@
+#ifndef _QGIS_pnwRotationPlugin_STATION_INDEX_H_
+#define _QGIS_pnwRotationPlugin_STATION_INDEX_H_
+
+#include <vector>
+
+// Static 2D k-d tree over station lon/lat (deg).
+// Built once from the rotation layer, then serves nearest and k-nearest
+// queries without touching the layer or decoding attributes.
+// Distances are squared degrees, matching the original brute-force scan.
+class StationIndex
+{
+public:
+   /// @brief Build the tree. Station ids are the positions in the input arrays.
+   void build(const std::vector<double> &lon, const std::vector<double> &lat);
+   void clear();
+
+   bool empty() const { return m_nodes.empty(); }
+   int size() const { return (int)m_nodes.size(); }
+
+   /// @brief Station extent in deg, false if the index is empty.
+   bool bounds(double &lonMin, double &lonMax, double &latMin, double &latMax) const;
+
+   /// @brief Closest station id, -1 if the index is empty.
+   int nearest(double lon, double lat, double *dist2 = nullptr) const;
+
+   /// @brief Up to k closest station ids sorted by increasing distance.
+   /// @return number of ids written to indices
+   int kNearest(double lon, double lat, int k, std::vector<int> &indices, std::vector<double> *dist2 = nullptr) const;
+
+private:
+   struct Node
+   {
+      double p[2]; // lon, lat
+      int id;
+   };
+
+   struct Candidate
+   {
+      double dist2;
+      int id;
+   };
+
+   // Implicit balanced tree: the median of [lo, hi) sits at (lo + hi) / 2,
+   // split axis alternates lon / lat with depth.
+   std::vector<Node> m_nodes;
+
+   void buildRange(int lo, int hi, int axis);
+   void nearestRange(int lo, int hi, int axis, const double q[2], Candidate &best) const;
+   void kNearestRange(int lo, int hi, int axis, const double q[2], int k, std::vector<Candidate> &heap) const;
+};
+
+#endif
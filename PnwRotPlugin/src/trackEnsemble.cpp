@@ -0,0 +1,230 @@
+#include "trackEnsemble.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
+
+namespace
+{
+   const double RASTER_MARGIN = 1.0; // deg past the stations, start and limit
+
+   uint64_t splitMix64(uint64_t x)
+   {
+      x += 0x9E3779B97F4A7C15ull;
+      x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+      x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+      return x ^ (x >> 31);
+   }
+
+   // Per thread copy of the field holding the current member's velocities
+   struct Workspace
+   {
+      RotFieldSnapshot field;
+      std::vector<int> stamp;  // last member to mark each cell, so a member counts once
+      std::vector<int> counts; // members crossing each cell
+      long long evaluations = 0;
+   };
+
+   // Linear interpolation between order statistics
+   double percentile(const std::vector<double> &sorted, double pct)
+   {
+      const double pos = std::clamp(pct / 100.0, 0.0, 1.0) * (sorted.size() - 1);
+      const size_t lo = (size_t)pos;
+      const size_t hi = std::min(lo + 1, sorted.size() - 1);
+      return sorted[lo] + (pos - lo) * (sorted[hi] - sorted[lo]);
+   }
+}
+
+bool runTrackEnsemble(const RotFieldSnapshot &field,
+                      const EnsembleParams &params,
+                      EnsembleResult &result,
+                      const std::function<bool()> &cancelled,
+                      const std::function<void(double)> &progress)
+{
+   result = EnsembleResult();
+   if (field.index.empty() || params.members < 1 || params.cellDeg <= 0 || params.lonSampleDeg <= 0)
+      return false;
+
+   const int N = field.index.size();
+   const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+   // Density raster over the stations, the start and the limit
+   double lonMin, lonMax, latMin, latMax;
+   field.index.bounds(lonMin, lonMax, latMin, latMax);
+   lonMin = std::min(lonMin, params.longitudeLimit) - RASTER_MARGIN;
+   lonMax = std::max(lonMax, params.startLon) + RASTER_MARGIN;
+   latMin = std::min(latMin, params.startLat) - RASTER_MARGIN;
+   latMax = std::max(latMax, params.startLat) + RASTER_MARGIN;
+   result.lonMin = lonMin;
+   result.latMax = latMax;
+   result.cellDeg = params.cellDeg;
+   result.cols = (int)std::ceil((lonMax - lonMin) / params.cellDeg);
+   result.rows = (int)std::ceil((latMax - latMin) / params.cellDeg);
+   const size_t cells = (size_t)result.cols * result.rows;
+
+   auto cellOf = [&](double lon, double lat) -> long long
+   {
+      const int c = (int)std::floor((lon - result.lonMin) / result.cellDeg);
+      const int r = (int)std::floor((result.latMax - lat) / result.cellDeg);
+      if (c < 0 || r < 0 || c >= result.cols || r >= result.rows)
+         return -1;
+      return (long long)r * result.cols + c;
+   };
+
+   // Envelope sample longitudes heading west from the start
+   for (int s = 1; params.startLon - s * params.lonSampleDeg >= params.longitudeLimit; s++)
+      result.sampleLon.push_back(params.startLon - s * params.lonSampleDeg);
+   const int S = (int)result.sampleLon.size();
+   std::vector<double> crossLat((size_t)params.members * S, NaN);
+
+   // One set of grid weights serves every member's station velocities.
+   // Unperturbed members step on the snapshot's own grid, like a single track.
+   const bool perturbStations = params.stationSigmaScale > 0 && (int)field.se.size() == N && (int)field.sn.size() == N;
+   VelocityGrid::Stencil stencil;
+   VelocityGrid memberGrid;
+   const bool gridded = perturbStations && !field.grid.empty() && memberGrid.layout(field.index, field.gridParams, stencil);
+
+   int threads = params.threads > 0 ? params.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+   threads = std::min(threads, params.members);
+   std::vector<Workspace> workspaces(threads);
+   for (Workspace &ws : workspaces)
+   {
+      // Perturbed members without a grid of their own step on their perturbed stations
+      ws.field = field;
+      if (gridded)
+         ws.field.grid = memberGrid;
+      else if (perturbStations)
+         ws.field.grid.clear();
+      ws.stamp.assign(cells, -1);
+      ws.counts.assign(cells, 0);
+   }
+
+   auto runMember = [&](int m, Workspace &ws)
+   {
+      // Draws depend only on the seed and member, never on the thread
+      std::mt19937_64 rng(splitMix64(params.seed ^ splitMix64(m)));
+      std::normal_distribution<double> normal;
+
+      const double speed = params.speed + params.speedSigma * normal(rng);
+      const double bearing = (params.bearing + params.bearingSigma * normal(rng)) / TrackKinematics::DEG_PER_RAD;
+      TrackState p = {params.startLon, params.startLat, std::sin(bearing) * speed, std::cos(bearing) * speed};
+
+      if (perturbStations)
+      {
+         for (int i = 0; i < N; i++)
+         {
+            ws.field.ve[i] = field.ve[i] + params.stationSigmaScale * field.se[i] * normal(rng);
+            ws.field.vn[i] = field.vn[i] + params.stationSigmaScale * field.sn[i] * normal(rng);
+         }
+         if (gridded)
+            ws.field.grid.resample(stencil, ws.field.ve, ws.field.vn);
+      }
+
+      auto mark = [&](double lon, double lat)
+      {
+         const long long cell = cellOf(lon, lat);
+         if (cell >= 0 && ws.stamp[cell] != m)
+         {
+            ws.stamp[cell] = m;
+            ws.counts[cell]++;
+         }
+      };
+      mark(p.lon, p.lat);
+
+      TrackStepper stepper(ws.field, params.method, params.deltaT, params.toleranceKm);
+      double h = params.deltaT;
+      double hNext;
+      double *cross = &crossLat[(size_t)m * S];
+      int sample = 0;
+      for (int step = 0; step < params.maxSteps && p.lon > params.longitudeLimit; step++)
+      {
+         const TrackState q = stepper.step(p, h, hNext);
+         h = hNext;
+
+         // First crossing of each sample longitude, p is always east of the next sample
+         while (sample < S && q.lon <= result.sampleLon[sample])
+         {
+            const double t = (p.lon - result.sampleLon[sample]) / (p.lon - q.lon);
+            cross[sample++] = p.lat + t * (q.lat - p.lat);
+         }
+
+         // Walk the segment at half cell spacing so long steps still mark every cell crossed
+         const int parts = std::max(1, (int)std::ceil(std::max(std::abs(q.lon - p.lon), std::abs(q.lat - p.lat)) / (0.5 * params.cellDeg)));
+         for (int i = 1; i <= parts; i++)
+         {
+            const double t = (double)i / parts;
+            mark(p.lon + t * (q.lon - p.lon), p.lat + t * (q.lat - p.lat));
+         }
+         p = q;
+      }
+      ws.evaluations += stepper.evaluations();
+   };
+
+   // Members are handed out one at a time, cancellation and progress stay on the calling thread
+   std::atomic<int> next{0};
+   std::atomic<int> done{0};
+   std::atomic<bool> stop{false};
+   auto worker = [&](int t)
+   {
+      for (int m = next++; m < params.members && !stop; m = next++)
+      {
+         if (t == 0 && cancelled && cancelled())
+         {
+            stop = true;
+            break;
+         }
+         runMember(m, workspaces[t]);
+         const int finished = ++done;
+         if (t == 0 && progress)
+            progress((double)finished / params.members);
+      }
+   };
+
+   std::vector<std::thread> pool;
+   pool.reserve(threads - 1);
+   for (int t = 1; t < threads; t++)
+      pool.emplace_back(worker, t);
+   worker(0);
+   for (std::thread &thread : pool)
+      thread.join();
+
+   result.members = done;
+   if (result.members == 0)
+      return false;
+
+   // Integer counts merge the same way in any order
+   std::vector<int> counts(cells, 0);
+   for (const Workspace &ws : workspaces)
+   {
+      for (size_t c = 0; c < cells; c++)
+         counts[c] += ws.counts[c];
+      result.evaluations += ws.evaluations;
+   }
+   result.density.resize(cells);
+   for (size_t c = 0; c < cells; c++)
+      result.density[c] = (float)counts[c] / result.members;
+
+   result.sampleCount.assign(S, 0);
+   result.envelopeLat.assign(params.percentiles.size(), std::vector<double>(S, NaN));
+   std::vector<double> lats;
+   for (int s = 0; s < S; s++)
+   {
+      lats.clear();
+      for (int m = 0; m < params.members; m++)
+      {
+         const double lat = crossLat[(size_t)m * S + s];
+         if (!std::isnan(lat))
+            lats.push_back(lat);
+      }
+      result.sampleCount[s] = (int)lats.size();
+      if (lats.empty())
+         continue;
+
+      std::sort(lats.begin(), lats.end());
+      for (size_t k = 0; k < params.percentiles.size(); k++)
+         result.envelopeLat[k][s] = percentile(lats, params.percentiles[k]);
+   }
+   return true;
+}
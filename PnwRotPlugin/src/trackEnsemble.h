@@ -0,0 +1,65 @@
+#ifndef _QGIS_pnwRotationPlugin_TRACK_ENSEMBLE_H_
+#define _QGIS_pnwRotationPlugin_TRACK_ENSEMBLE_H_
+
+#include "trackIntegrator.h"
+#include <cstdint>
+#include <functional>
+
+// Monte-Carlo track settings. Each member draws its own plate motion and
+// station velocities, then integrates one track to the longitude limit.
+struct EnsembleParams
+{
+   int members = 1000;
+   uint64_t seed = 1;
+   int threads = 0; // 0 uses every hardware thread
+
+   double startLon = 0; // deg
+   double startLat = 0; // deg
+   double speed = 0;    // plate speed, mm/yr
+   double speedSigma = 0;
+   double bearing = 0; // plate bearing, deg
+   double bearingSigma = 0;
+   double stationSigmaScale = 1.0; // station velocity noise in multiples of Se / Sn
+
+   TrackIntegrator method = TrackIntegrator::RK45;
+   double deltaT = 1E6; // years
+   double toleranceKm = 1.0;
+   double longitudeLimit = -126.0;
+   int maxSteps = 10000; // per member
+
+   double cellDeg = 0.1;      // density raster cell
+   double lonSampleDeg = 0.25; // envelope sample spacing west of the start
+   std::vector<double> percentiles = {5, 25, 50, 75, 95};
+};
+
+struct EnsembleResult
+{
+   int members = 0; // members run, fewer than requested if cancelled
+   long long evaluations = 0;
+
+   // Fraction of members whose track crosses each cell, row major from the north
+   double lonMin = 0; // west edge, deg
+   double latMax = 0; // north edge, deg
+   double cellDeg = 0;
+   int cols = 0;
+   int rows = 0;
+   std::vector<float> density;
+
+   // Track latitude percentiles where the members cross each sample longitude,
+   // NaN where no member reached the sample
+   std::vector<double> sampleLon;
+   std::vector<int> sampleCount;
+   std::vector<std::vector<double>> envelopeLat; // [percentile][sample]
+};
+
+/// @brief Run the ensemble across threads. Results depend on the seed only,
+/// not on the thread count or scheduling.
+/// @param cancelled polled between members, the partial ensemble is returned
+/// @param progress called with the completed fraction from the calling thread
+bool runTrackEnsemble(const RotFieldSnapshot &field,
+                      const EnsembleParams &params,
+                      EnsembleResult &result,
+                      const std::function<bool()> &cancelled = nullptr,
+                      const std::function<void(double)> &progress = nullptr);
+
+#endif
@@ -0,0 +1,141 @@
+#include "trackIntegrator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+   // p + h * sum(c[i] * k[i])
+   TrackState combine(const TrackState &p, double h, const double *c, const TrackState *k, int n)
+   {
+      TrackState q = p;
+      for (int i = 0; i < n; i++)
+      {
+         if (c[i] == 0)
+            continue;
+         q.lon += h * c[i] * k[i].lon;
+         q.lat += h * c[i] * k[i].lat;
+         q.ve += h * c[i] * k[i].ve;
+         q.vn += h * c[i] * k[i].vn;
+      }
+      return q;
+   }
+
+   // Dormand-Prince 5(4) tableau
+   const double DP_A2[1] = {1.0 / 5};
+   const double DP_A3[2] = {3.0 / 40, 9.0 / 40};
+   const double DP_A4[3] = {44.0 / 45, -56.0 / 15, 32.0 / 9};
+   const double DP_A5[4] = {19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729};
+   const double DP_A6[5] = {9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656};
+   const double DP_B5[6] = {35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84};
+   const double DP_E[7] = {71.0 / 57600, 0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200, 22.0 / 525, -1.0 / 40};
+
+   const double SAFETY = 0.9;
+   const double MIN_SCALE = 0.2;
+   const double MAX_SCALE = 5.0;
+}
+
+TrackStepper::TrackStepper(const RotFieldSnapshot &field, TrackIntegrator method, double velocityPeriod, double toleranceKm)
+    : m_field(field),
+      m_method(method),
+      m_period(velocityPeriod),
+      m_toleranceKm(toleranceKm)
+{
+}
+
+TrackState TrackStepper::step(const TrackState &p, double &h, double &hNext)
+{
+   switch (m_method)
+   {
+   case TrackIntegrator::RK4:
+      hNext = h;
+      return stepRK4(p, h);
+   case TrackIntegrator::RK45:
+      return stepRK45(p, h, hNext);
+   default:
+      hNext = h;
+      return stepEuler(p, h);
+   }
+}
+
+// State rates per year: deg/yr for lon / lat, mm/yr per yr for ve / vn
+TrackState TrackStepper::derivative(const TrackState &p)
+{
+   double rotVe, rotVn;
+   m_field.velocity(p.lon, p.lat, rotVe, rotVn);
+   m_evaluations++;
+   return {TrackKinematics::longitudeFromDistance(p.lat, p.ve),
+           TrackKinematics::latitudeFromDistance(p.vn),
+           rotVe / m_period,
+           rotVn / m_period};
+}
+
+TrackState TrackStepper::stepEuler(const TrackState &p, double h)
+{
+   double rotVe, rotVn;
+   m_field.velocity(p.lon, p.lat, rotVe, rotVn);
+   m_evaluations++;
+   const double scale = h / m_period; // 1 for the original detlaT steps
+   return TrackKinematics::eulerStep(p, rotVe * scale, rotVn * scale, h);
+}
+
+TrackState TrackStepper::stepRK4(const TrackState &p, double h)
+{
+   const double half[1] = {0.5};
+   const double halfB[2] = {0, 0.5};
+   const double full[3] = {0, 0, 1};
+   const double weights[4] = {1.0 / 6, 1.0 / 3, 1.0 / 3, 1.0 / 6};
+
+   TrackState k[4];
+   k[0] = derivative(p);
+   k[1] = derivative(combine(p, h, half, k, 1));
+   k[2] = derivative(combine(p, h, halfB, k, 2));
+   k[3] = derivative(combine(p, h, full, k, 3));
+   return combine(p, h, weights, k, 4);
+}
+
+TrackState TrackStepper::stepRK45(const TrackState &p, double &h, double &hNext)
+{
+   const double minStep = m_period * 1E-6;
+
+   TrackState k[7];
+   const bool reuse = m_fsalValid && m_fsalState.lon == p.lon && m_fsalState.lat == p.lat &&
+                      m_fsalState.ve == p.ve && m_fsalState.vn == p.vn;
+   k[0] = reuse ? m_fsalRate : derivative(p);
+
+   for (;;)
+   {
+      k[1] = derivative(combine(p, h, DP_A2, k, 1));
+      k[2] = derivative(combine(p, h, DP_A3, k, 2));
+      k[3] = derivative(combine(p, h, DP_A4, k, 3));
+      k[4] = derivative(combine(p, h, DP_A5, k, 4));
+      k[5] = derivative(combine(p, h, DP_A6, k, 5));
+      const TrackState next = combine(p, h, DP_B5, k, 6);
+      k[6] = derivative(next);
+
+      const TrackState zero = {0, 0, 0, 0};
+      const double ratio = errorKm(p, combine(zero, h, DP_E, k, 7), h) / m_toleranceKm;
+      if (ratio <= 1 || h <= minStep)
+      {
+         const double scale = ratio > 0 ? SAFETY * std::pow(ratio, -0.2) : MAX_SCALE;
+         hNext = h * std::clamp(scale, MIN_SCALE, MAX_SCALE);
+         m_fsalState = next;
+         m_fsalRate = k[6];
+         m_fsalValid = true;
+         return next;
+      }
+
+      m_rejected++;
+      h = std::max(minStep, h * std::max(MIN_SCALE, SAFETY * std::pow(ratio, -0.25)));
+   }
+}
+
+// Local error as distance on the sphere. A velocity error is counted as
+// the distance it would add over a step of the same length.
+double TrackStepper::errorKm(const TrackState &p, const TrackState &err, double h) const
+{
+   const double kmPerDeg = TrackKinematics::EARTH_RADIUS / 1000 / TrackKinematics::DEG_PER_RAD;
+   const double north = err.lat * kmPerDeg;
+   const double east = err.lon * kmPerDeg * std::cos(p.lat / TrackKinematics::DEG_PER_RAD);
+   const double velocity = std::hypot(err.ve, err.vn) * std::abs(h) / 1E6; // mm -> km
+   return std::max(std::hypot(north, east), velocity);
+}
@@ -0,0 +1,51 @@
+#ifndef _QGIS_pnwRotationPlugin_TRACK_INTEGRATOR_H_
+#define _QGIS_pnwRotationPlugin_TRACK_INTEGRATOR_H_
+
+#include "trackKinematics.h"
+
+enum class TrackIntegrator
+{
+   Euler, // fixed steps, the original scheme, 1 field evaluation per step
+   RK4,   // fixed steps, 4 evaluations per step
+   RK45   // Dormand-Prince 5(4), step size set by a distance tolerance
+};
+
+// Steps a track state through the rotation field.
+// The Euler loop moves by the current velocity and adds the field velocity
+// once per velocityPeriod years, which is the continuous system
+//    d(lon, lat)/dt = (ve, vn) on the sphere
+//    d(ve, vn)/dt   = field(lon, lat) / velocityPeriod
+// The higher order schemes solve the same system in fewer, larger steps.
+class TrackStepper
+{
+public:
+   TrackStepper(const RotFieldSnapshot &field, TrackIntegrator method, double velocityPeriod, double toleranceKm = 1.0);
+
+   /// @brief Advance p by one step. h is the step to try in years and on return
+   /// holds the step taken, hNext is the step to try next.
+   TrackState step(const TrackState &p, double &h, double &hNext);
+
+   long long evaluations() const { return m_evaluations; } // field lookups so far
+   long long rejected() const { return m_rejected; }       // RK45 steps retried with a smaller h
+
+private:
+   const RotFieldSnapshot &m_field;
+   TrackIntegrator m_method;
+   double m_period;      // years
+   double m_toleranceKm; // per step position error, RK45 only
+   long long m_evaluations = 0;
+   long long m_rejected = 0;
+
+   // First same as last: the final RK45 stage is the next step's first
+   TrackState m_fsalState = {};
+   TrackState m_fsalRate = {};
+   bool m_fsalValid = false;
+
+   TrackState derivative(const TrackState &p);
+   TrackState stepEuler(const TrackState &p, double h);
+   TrackState stepRK4(const TrackState &p, double h);
+   TrackState stepRK45(const TrackState &p, double &h, double &hNext);
+   double errorKm(const TrackState &p, const TrackState &err, double h) const;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef _QGIS_pnwRotationPlugin_TRACK_KINEMATICS_H_
+#define _QGIS_pnwRotationPlugin_TRACK_KINEMATICS_H_
+
+#include "stationIndex.h"
+#include "velocityGrid.h"
+#include <cmath>
+#include <vector>
+
+// Track state and step rules shared by the GUI plugin and background runs.
+// Velocity units match the Zeng data: mm/yr.
+struct TrackState
+{
+   double lon; // deg
+   double lat; // deg
+   double ve;  // mm/yr
+   double vn;  // mm/yr
+};
+
+// Read-only copy of the station velocity field taken when the rot layer
+// is loaded. Background runs share it, so they never touch QGIS layers.
+struct RotFieldSnapshot
+{
+   StationIndex index;     // station lon/lat
+   std::vector<double> ve; // mm/yr per station
+   std::vector<double> vn; // mm/yr per station
+   std::vector<double> se; // ve sigma, mm/yr per station
+   std::vector<double> sn; // vn sigma, mm/yr per station
+   VelocityGrid grid;      // interpolated ve / vn, empty to step on the nearest station
+   VelocityGridParams gridParams;
+
+   // Velocity at lon, lat: the grid where it covers the point, else the nearest station
+   inline void velocity(double lon, double lat, double &rotVe, double &rotVn) const
+   {
+      if (!grid.sample(lon, lat, rotVe, rotVn))
+      {
+         const int station = index.nearest(lon, lat);
+         rotVe = ve[station];
+         rotVn = vn[station];
+      }
+   }
+};
+
+namespace TrackKinematics
+{
+   const double EARTH_RADIUS = 6371000; // meters
+   const double DEG_PER_RAD = 180.0 / 3.14159265358979323846;
+
+   // Meters N to latitude, distance is in mm
+   inline double latitudeFromDistance(double distanceN)
+   {
+      return atan(distanceN / (EARTH_RADIUS * 1000)) * DEG_PER_RAD;
+   }
+
+   // Longitude change moving eastward at the given latitude, distance is in mm
+   inline double longitudeFromDistance(double latitude, double distance)
+   {
+      // Radius of the parallel of latitude at the starting latitude
+      double radiusOfParallel = EARTH_RADIUS * std::cos(latitude / DEG_PER_RAD);
+      return distance / (radiusOfParallel * 1000) * DEG_PER_RAD;
+   }
+
+   // One forward Euler step of deltaT years: move by the current velocity,
+   // then add the rotation field velocity
+   inline TrackState eulerStep(const TrackState &p, double rotVe, double rotVn, double deltaT)
+   {
+      return {p.lon + longitudeFromDistance(p.lat, p.ve * deltaT),
+              p.lat + latitudeFromDistance(p.vn * deltaT),
+              p.ve + rotVe,
+              p.vn + rotVn};
+   }
+}
+
+#endif
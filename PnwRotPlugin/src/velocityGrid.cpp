@@ -0,0 +1,235 @@
+#include "velocityGrid.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+   const char GRID_MAGIC[8] = {'P', 'N', 'W', 'V', 'G', 'R', 'D', '\0'};
+   const uint32_t GRID_VERSION = 1;
+   const int MAX_GRID_NODES = 1 << 24; // guards against a tiny step over a large region
+
+   struct GridHeader
+   {
+      char magic[8];
+      uint32_t version;
+      uint32_t cols;
+      uint32_t rows;
+      uint32_t reserved;
+      uint64_t key;
+      double lon0;
+      double lat0;
+      double step;
+   };
+
+   // Per writer temp name so plugin instances caching the same key never share a partial file
+   std::string tempFileName(const std::string &filename)
+   {
+      std::random_device device;
+      const uint64_t salt = ((uint64_t)device() << 32 | device()) ^
+                            (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+      std::ostringstream name;
+      name << filename << "." << std::hex << salt << ".tmp";
+      return name.str();
+   }
+
+   void hashBytes(uint64_t &hash, const void *data, size_t size)
+   {
+      const unsigned char *p = (const unsigned char *)data;
+      for (size_t n = 0; n < size; n++)
+      {
+         hash ^= p[n];
+         hash *= 1099511628211ull;
+      }
+   }
+}
+
+bool VelocityGrid::build(const StationIndex &index, const std::vector<double> &ve, const std::vector<double> &vn, const VelocityGridParams &params)
+{
+   Stencil stencil;
+   if (!layout(index, params, stencil))
+      return false;
+
+   resample(stencil, ve, vn);
+   return true;
+}
+
+bool VelocityGrid::layout(const StationIndex &index, const VelocityGridParams &params, Stencil &stencil)
+{
+   clear();
+   stencil = Stencil();
+   if (index.empty() || params.step <= 0 || params.neighbours < 1)
+      return false;
+
+   double lonMin, lonMax, latMin, latMax;
+   index.bounds(lonMin, lonMax, latMin, latMax);
+   m_lon0 = lonMin - params.margin;
+   m_lat0 = latMin - params.margin;
+   m_step = params.step;
+   m_cols = std::max(2, (int)std::ceil((lonMax + params.margin - m_lon0) / m_step) + 1);
+   m_rows = std::max(2, (int)std::ceil((latMax + params.margin - m_lat0) / m_step) + 1);
+   if ((double)m_cols * m_rows > MAX_GRID_NODES)
+   {
+      m_cols = m_rows = 0;
+      return false;
+   }
+
+   const int k = params.neighbours;
+   const size_t nodes = (size_t)m_cols * m_rows;
+   stencil.k = k;
+   stencil.ids.assign(nodes * k, 0);
+   stencil.weights.assign(nodes * k, 0.0f);
+
+   std::vector<int> ids;
+   std::vector<double> dist2, w;
+   for (int r = 0; r < m_rows; r++)
+   {
+      const double lat = m_lat0 + r * m_step;
+      for (int c = 0; c < m_cols; c++)
+      {
+         const double lon = m_lon0 + c * m_step;
+         index.kNearest(lon, lat, k, ids, &dist2);
+
+         // Inverse distance weights, a node sitting on a station takes it exactly
+         int *nodeIds = &stencil.ids[((size_t)r * m_cols + c) * k];
+         float *nodeWeights = &stencil.weights[((size_t)r * m_cols + c) * k];
+         w.assign(ids.size(), 0.0);
+         double sumW = 0;
+         for (size_t j = 0; j < ids.size(); j++)
+         {
+            if (dist2[j] <= 0)
+            {
+               std::fill(w.begin(), w.end(), 0.0);
+               w[j] = sumW = 1;
+               break;
+            }
+            w[j] = std::pow(dist2[j], -0.5 * params.power);
+            sumW += w[j];
+         }
+         for (size_t j = 0; j < ids.size(); j++)
+         {
+            nodeIds[j] = ids[j];
+            nodeWeights[j] = (float)(w[j] / sumW);
+         }
+      }
+   }
+
+   m_v.assign(2 * nodes, 0.0f);
+   return true;
+}
+
+void VelocityGrid::resample(const Stencil &stencil, const std::vector<double> &ve, const std::vector<double> &vn)
+{
+   const size_t nodes = m_v.size() / 2;
+   const int k = stencil.k;
+   for (size_t n = 0; n < nodes; n++)
+   {
+      const int *ids = &stencil.ids[n * k];
+      const float *weights = &stencil.weights[n * k];
+      double sumVe = 0, sumVn = 0;
+      for (int j = 0; j < k; j++)
+      {
+         sumVe += weights[j] * ve[ids[j]];
+         sumVn += weights[j] * vn[ids[j]];
+      }
+      m_v[2 * n] = (float)sumVe;
+      m_v[2 * n + 1] = (float)sumVn;
+   }
+}
+
+void VelocityGrid::clear()
+{
+   m_v.clear();
+   m_cols = m_rows = 0;
+}
+
+uint64_t VelocityGrid::cacheKey(const std::string &source,
+                                const std::vector<double> &lon, const std::vector<double> &lat,
+                                const std::vector<double> &ve, const std::vector<double> &vn,
+                                const VelocityGridParams &params)
+{
+   uint64_t hash = 14695981039346656037ull;
+   hashBytes(hash, source.data(), source.size());
+   hashBytes(hash, &GRID_VERSION, sizeof(GRID_VERSION));
+   hashBytes(hash, &params.step, sizeof(params.step));
+   hashBytes(hash, &params.margin, sizeof(params.margin));
+   hashBytes(hash, &params.neighbours, sizeof(params.neighbours));
+   hashBytes(hash, &params.power, sizeof(params.power));
+   for (const std::vector<double> *values : {&lon, &lat, &ve, &vn})
+      hashBytes(hash, values->data(), values->size() * sizeof(double));
+   return hash;
+}
+
+bool VelocityGrid::load(const std::string &filename, uint64_t key)
+{
+   clear();
+   std::ifstream file(filename, std::ios::binary);
+   if (!file)
+      return false;
+
+   GridHeader header;
+   if (!file.read((char *)&header, sizeof(header)) ||
+       std::memcmp(header.magic, GRID_MAGIC, sizeof(GRID_MAGIC)) != 0 ||
+       header.version != GRID_VERSION || header.key != key ||
+       header.cols < 2 || header.rows < 2 || (double)header.cols * header.rows > MAX_GRID_NODES ||
+       !(header.step > 0))
+      return false;
+
+   std::vector<float> v(2 * (size_t)header.cols * header.rows);
+   if (!file.read((char *)v.data(), v.size() * sizeof(float)))
+      return false;
+
+   m_lon0 = header.lon0;
+   m_lat0 = header.lat0;
+   m_step = header.step;
+   m_cols = (int)header.cols;
+   m_rows = (int)header.rows;
+   m_v.swap(v);
+   return true;
+}
+
+bool VelocityGrid::save(const std::string &filename, uint64_t key) const
+{
+   if (empty())
+      return false;
+
+   GridHeader header = {};
+   std::memcpy(header.magic, GRID_MAGIC, sizeof(GRID_MAGIC));
+   header.version = GRID_VERSION;
+   header.cols = (uint32_t)m_cols;
+   header.rows = (uint32_t)m_rows;
+   header.key = key;
+   header.lon0 = m_lon0;
+   header.lat0 = m_lat0;
+   header.step = m_step;
+
+   // Write beside the target and rename so readers never see a partial grid
+   const std::string tmpName = tempFileName(filename);
+   bool written = false;
+   {
+      std::ofstream file(tmpName, std::ios::binary | std::ios::trunc);
+      if (file.is_open())
+      {
+         file.write((const char *)&header, sizeof(header));
+         file.write((const char *)m_v.data(), m_v.size() * sizeof(float));
+
+         // Checked after close so a short final flush fails too
+         file.close();
+         written = !file.fail();
+      }
+   }
+
+   std::error_code ec;
+   if (written)
+      std::filesystem::rename(tmpName, filename, ec);
+   if (!written || ec)
+   {
+      std::filesystem::remove(tmpName, ec);
+      return false;
+   }
+   return true;
+}
@@ -0,0 +1,91 @@
+#ifndef _QGIS_pnwRotationPlugin_VELOCITY_GRID_H_
+#define _QGIS_pnwRotationPlugin_VELOCITY_GRID_H_
+
+#include "stationIndex.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Interpolation settings for VelocityGrid::build
+struct VelocityGridParams
+{
+   double step = 0.1;   // node spacing, deg
+   double margin = 0.5; // grid extends this far past the outermost stations, deg
+   int neighbours = 8;  // stations blended per node
+   double power = 2.0;  // inverse-distance exponent
+};
+
+// Station Ve/Vn resampled once onto a regular lon/lat grid.
+// Each node is an inverse-distance blend of its nearest stations, lookups
+// are bilinear in the four surrounding nodes, so a track step costs a few
+// loads and the sampled field varies smoothly between stations.
+class VelocityGrid
+{
+public:
+   // Node interpolation weights, k stations per node. The grid is linear in
+   // the station velocities, so one stencil serves any set of velocities.
+   struct Stencil
+   {
+      int k = 0;
+      std::vector<int> ids;       // node * k + j
+      std::vector<float> weights; // sum to 1 per node
+   };
+
+   /// @brief Interpolate station velocities (mm/yr) onto a grid covering the stations.
+   /// Station ids in index are positions in ve / vn.
+   bool build(const StationIndex &index, const std::vector<double> &ve, const std::vector<double> &vn, const VelocityGridParams &params);
+
+   /// @brief Place the grid over the stations and compute node weights, nodes are zeroed.
+   bool layout(const StationIndex &index, const VelocityGridParams &params, Stencil &stencil);
+
+   /// @brief Fill the nodes from station velocities using the weights from layout.
+   void resample(const Stencil &stencil, const std::vector<double> &ve, const std::vector<double> &vn);
+
+   void clear();
+
+   bool empty() const { return m_v.empty(); }
+   int cols() const { return m_cols; }
+   int rows() const { return m_rows; }
+
+   /// @brief Bilinear velocity (mm/yr) at lon, lat (deg).
+   /// @return false outside the grid, ve / vn untouched
+   inline bool sample(double lon, double lat, double &ve, double &vn) const
+   {
+      const double fx = (lon - m_lon0) / m_step;
+      const double fy = (lat - m_lat0) / m_step;
+      if (m_v.empty() || !(fx >= 0 && fy >= 0 && fx <= m_cols - 1 && fy <= m_rows - 1))
+         return false;
+
+      const int c = std::min((int)fx, m_cols - 2);
+      const int r = std::min((int)fy, m_rows - 2);
+      const double u = fx - c;
+      const double v = fy - r;
+      const float *p0 = &m_v[2 * ((size_t)r * m_cols + c)]; // ve, vn interleaved
+      const float *p1 = p0 + 2 * m_cols;
+      const double w00 = (1 - u) * (1 - v), w10 = u * (1 - v), w01 = (1 - u) * v, w11 = u * v;
+      ve = w00 * p0[0] + w10 * p0[2] + w01 * p1[0] + w11 * p1[2];
+      vn = w00 * p0[1] + w10 * p0[3] + w01 * p1[1] + w11 * p1[3];
+      return true;
+   }
+
+   /// @brief Cache key over the source name, station data and interpolation settings
+   static uint64_t cacheKey(const std::string &source,
+                            const std::vector<double> &lon, const std::vector<double> &lat,
+                            const std::vector<double> &ve, const std::vector<double> &vn,
+                            const VelocityGridParams &params);
+
+   /// @brief Read a grid written by save, false if missing, stale or a different key
+   bool load(const std::string &filename, uint64_t key);
+   bool save(const std::string &filename, uint64_t key) const;
+
+private:
+   double m_lon0 = 0; // south west node, deg
+   double m_lat0 = 0;
+   double m_step = 1;
+   int m_cols = 0;
+   int m_rows = 0;
+   std::vector<float> m_v; // row major from the south, ve / vn pairs
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "yhsTrackTask.h"
+#include "profiler.h"
+#include <QElapsedTimer>
+#include <algorithm>
+
+YhsTrackTask::YhsTrackTask(int runId,
+                           std::shared_ptr<const RotFieldSnapshot> field,
+                           const TrackState &start,
+                           double deltaT,
+                           double longitudeLimit,
+                           int batchIntervalMs,
+                           TrackIntegrator method,
+                           double toleranceKm)
+    : QgsTask(QString("YHS track %1").arg(runId), QgsTask::CanCancel),
+      m_runId(runId),
+      m_field(std::move(field)),
+      m_start(start),
+      m_deltaT(deltaT),
+      m_longitudeLimit(longitudeLimit),
+      m_batchIntervalMs(batchIntervalMs),
+      m_method(method),
+      m_toleranceKm(toleranceKm)
+{
+}
+
+bool YhsTrackTask::run()
+{
+   ProfileScope scope("YhsTrackTask::run");
+   if (!m_field || m_field->index.empty())
+      return false;
+
+   QVector<YhsTrackStep> batch;
+   QElapsedTimer batchTimer;
+   batchTimer.start();
+
+   // deltaT is both the first step tried and the period over which the
+   // original scheme adds one field velocity
+   TrackStepper stepper(*m_field, m_method, m_deltaT, m_toleranceKm);
+   double h = m_deltaT;
+
+   const double lonRange = m_start.lon - m_longitudeLimit;
+   TrackState p_last = m_start;
+   int steps = 0;
+   while (p_last.lon > m_longitudeLimit && steps < MAX_STEPS)
+   {
+      if (isCanceled())
+         break;
+
+      // The nearest station is kept for display, the step samples the field itself
+      const int station = m_field->index.nearest(p_last.lon, p_last.lat);
+      double hNext;
+      const TrackState p_next = stepper.step(p_last, h, hNext);
+      h = hNext;
+
+      batch.push_back({p_next, station, p_next.ve - p_last.ve, p_next.vn - p_last.vn, p_next.lon - p_last.lon, p_next.lat - p_last.lat});
+      p_last = p_next;
+      steps++;
+      m_steps = steps;
+      m_evaluations = stepper.evaluations();
+
+      if (batchTimer.elapsed() >= m_batchIntervalMs)
+      {
+         emit stepsReady(m_runId, batch);
+         batch.clear();
+         batchTimer.restart();
+         if (lonRange > 0)
+            setProgress(100.0 * std::min(1.0, (m_start.lon - p_last.lon) / lonRange));
+      }
+   }
+
+   if (!batch.isEmpty())
+      emit stepsReady(m_runId, batch);
+   setProgress(100.0);
+
+   return !isCanceled();
+}
+
+YhsEnsembleTask::YhsEnsembleTask(std::shared_ptr<const RotFieldSnapshot> field, const EnsembleParams &params)
+    : QgsTask(QString("YHS ensemble of %1").arg(params.members), QgsTask::CanCancel),
+      m_field(std::move(field)),
+      m_params(params)
+{
+}
+
+bool YhsEnsembleTask::run()
+{
+   ProfileScope scope("YhsEnsembleTask::run");
+   if (!m_field)
+      return false;
+
+   const bool ran = runTrackEnsemble(*m_field, m_params, m_result,
+                                     [this]() { return isCanceled(); },
+                                     [this](double fraction) { setProgress(100.0 * fraction); });
+   return ran && !isCanceled();
+}
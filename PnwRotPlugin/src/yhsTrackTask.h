@@ -0,0 +1,88 @@
+#ifndef _QGIS_pnwRotationPlugin_YHS_TRACK_TASK_H_
+#define _QGIS_pnwRotationPlugin_YHS_TRACK_TASK_H_
+
+#include "qgstaskmanager.h"
+#include "trackEnsemble.h"
+#include "trackIntegrator.h"
+#include <atomic>
+#include <QMetaType>
+#include <QVector>
+#include <memory>
+
+// One integration step handed back to the GUI thread
+struct YhsTrackStep
+{
+   TrackState state; // state after the step
+   int station;      // nearest rot station, index into the rot feature list
+   double rotVe;     // velocity gained from the rotation field over the step, mm/yr
+   double rotVn;     // mm/yr
+   double deltaLon;  // deg
+   double deltaLat;  // deg
+};
+Q_DECLARE_METATYPE(YhsTrackStep)
+Q_DECLARE_METATYPE(QVector<YhsTrackStep>)
+
+// Background YHS track integration.
+// Steps the track with the chosen integrator on a QgsTask thread against a station snapshot
+// and hands steps back in batches through stepsReady (queued onto the GUI
+// thread), at most once per batchIntervalMs and once at the end.
+class YhsTrackTask : public QgsTask
+{
+   Q_OBJECT
+
+public:
+   YhsTrackTask(int runId,
+                std::shared_ptr<const RotFieldSnapshot> field,
+                const TrackState &start,
+                double deltaT,
+                double longitudeLimit,
+                int batchIntervalMs,
+                TrackIntegrator method = TrackIntegrator::Euler,
+                double toleranceKm = 1.0);
+
+   int runId() const { return m_runId; }
+   long long fieldEvaluations() const { return m_evaluations; }
+   int steps() const { return m_steps; }
+
+   bool run() override;
+
+signals:
+   void stepsReady(int runId, QVector<YhsTrackStep> steps);
+
+private:
+   int m_runId;
+   std::shared_ptr<const RotFieldSnapshot> m_field;
+   TrackState m_start;
+   double m_deltaT;
+   double m_longitudeLimit;
+   int m_batchIntervalMs;
+   TrackIntegrator m_method;
+   double m_toleranceKm;
+   std::atomic<long long> m_evaluations{0};
+   std::atomic<int> m_steps{0};
+
+   static const int MAX_STEPS = 100000; // guard against tracks that never reach the limit
+};
+
+// Background Monte-Carlo track ensemble.
+// The members run across threads inside the task, the result is read back
+// on the GUI thread once the task completes.
+class YhsEnsembleTask : public QgsTask
+{
+   Q_OBJECT
+
+public:
+   YhsEnsembleTask(std::shared_ptr<const RotFieldSnapshot> field, const EnsembleParams &params);
+
+   const EnsembleParams &params() const { return m_params; }
+   const EnsembleResult &result() const { return m_result; }
+
+   bool run() override;
+
+private:
+   std::shared_ptr<const RotFieldSnapshot> m_field;
+   EnsembleParams m_params;
+   EnsembleResult m_result;
+};
+
+#endif